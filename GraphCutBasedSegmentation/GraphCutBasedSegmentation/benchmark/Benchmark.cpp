@@ -0,0 +1,309 @@
+#include "Benchmark.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "..\graphcut\GraphCutSegmentation.h"
+#include "..\lazy\LazySnapping.h"
+#include "..\hybrid\HybridSegmentation.h"
+
+Benchmark::Benchmark(const std::string& _srcDir, const std::string& _dstDir)
+	: srcDir(_srcDir), dstDir(_dstDir) {
+	setRepeats(5);
+	setSeed(0x12345678);
+	setTolerance(0.1f);
+	setMinIoU(0.99f);
+	setUpdateBaseline(false);
+}
+
+bool Benchmark::loadHint(const std::string& fileName, cv::Mat& seedMask,
+	std::vector<cv::Point>& hintBkg, std::vector<cv::Point>& hintObj) {
+
+	std::ifstream hintFile(srcDir + fileName + ".hint");
+	if (!hintFile.good())
+		return false;
+
+	hintBkg.clear();
+	hintObj.clear();
+
+	int nSeed;
+	hintFile >> nSeed;
+	for (int i = 0; i < nSeed; i++) {
+		int x, y;
+		hintFile >> x >> y;
+		seedMask.at<char>(y, x) = GraphCutSegmentation::BACKGROUND;
+		hintBkg.push_back({ x, y });
+	}
+	hintFile >> nSeed;
+	for (int i = 0; i < nSeed; i++) {
+		int x, y;
+		hintFile >> x >> y;
+		seedMask.at<char>(y, x) = GraphCutSegmentation::OBJECT;
+		hintObj.push_back({ x, y });
+	}
+
+	return true;
+}
+
+void Benchmark::runGraphCut(const cv::Mat& img, const cv::Mat& seedMask, Record& rec, cv::Mat& mask) {
+
+	GraphCutSegmentation gc;
+	gc.setSeed(seed);
+	gc.setPersistency(true);
+
+	int64 start = cv::getTickCount();
+	gc.segment(img, seedMask, mask);
+	int64 end = cv::getTickCount();
+	gc.cleanGarbage();
+
+	for (auto& stage : gc.getStageTimes())
+		rec.stages[stage.first].push_back(stage.second);
+	rec.stages["total"].push_back(double(end - start) / cv::getTickFrequency());
+
+}
+
+void Benchmark::runLazySnapping(const cv::Mat& img, const std::vector<cv::Point>& hintBkg,
+	const std::vector<cv::Point>& hintObj, Record& rec, cv::Mat& mask, const std::string& cacheKey) {
+
+	// A fresh instance per run, the seed matrices accumulate across runs
+	std::unique_ptr<LazySnapping> ls(new LazySnapping());
+	ls->setSeed(seed);
+
+	int64 start = cv::getTickCount();
+	ls->setSourceImage(img);
+	if (!cacheKey.empty())
+		ls->setSuperpixelCache(&superpixelCache, cacheKey);
+	ls->setBackgroundPoints(hintBkg);
+	ls->setForegroundPoints(hintObj);
+	ls->setUpdateB(!hintBkg.empty());
+	ls->setUpdateF(!hintObj.empty());
+	ls->runMaxFlow();
+	int64 end = cv::getTickCount();
+
+	for (auto& stage : ls->getStageTimes())
+		rec.stages[stage.first].push_back(stage.second);
+	rec.stages["total"].push_back(double(end - start) / cv::getTickFrequency());
+
+	mask = ls->getMask();
+
+}
+
+void Benchmark::runHybrid(const cv::Mat& img, const std::vector<cv::Point>& hintBkg,
+	const std::vector<cv::Point>& hintObj, Record& rec, cv::Mat& mask) {
+
+	std::unique_ptr<HybridSegmentation> hs(new HybridSegmentation());
+	hs->setSeed(seed);
+
+	int64 start = cv::getTickCount();
+	hs->segment(img, hintBkg, hintObj, mask);
+	int64 end = cv::getTickCount();
+
+	for (auto& stage : hs->getStageTimes())
+		rec.stages[stage.first].push_back(stage.second);
+	rec.stages["total"].push_back(double(end - start) / cv::getTickFrequency());
+
+}
+
+const double Benchmark::NO_REFERENCE = -1.0;
+
+double Benchmark::checkMask(const Record& rec, const cv::Mat& mask) {
+
+	std::string refFile = dstDir + rec.image + "_" + rec.method + "_mask.png";
+	cv::Mat ref = cv::imread(refFile, cv::IMREAD_GRAYSCALE);
+
+	// References only ever come from a run that was asked to update them
+	if (updateBaseline)
+		cv::imwrite(refFile, mask);
+
+	if (ref.empty())
+		return NO_REFERENCE;
+
+	if (ref.size() != mask.size())
+		return 0.0;
+
+	int inter = 0, uni = 0;
+	for (int r = 0; r < mask.rows; r++) {
+		const uchar* m = mask.ptr<uchar>(r);
+		const uchar* f = ref.ptr<uchar>(r);
+		for (int c = 0; c < mask.cols; c++) {
+			bool a = m[c] != 0, b = f[c] != 0;
+			inter += (a && b);
+			uni += (a || b);
+		}
+	}
+
+	return uni == 0 ? 1.0 : double(inter) / uni;
+
+}
+
+void Benchmark::loadBaseline() {
+
+	baseline.clear();
+	std::ifstream ifs(dstDir + "baseline.csv");
+	std::string line;
+
+	while (std::getline(ifs, line)) {
+		auto pos = line.find_last_of(',');
+		if (pos == std::string::npos)
+			continue;
+		baseline[line.substr(0, pos)] = std::atof(line.substr(pos + 1).c_str());
+	}
+
+}
+
+void Benchmark::saveBaseline() {
+
+	std::ofstream ofs(dstDir + "baseline.csv");
+	for (auto& rec : records)
+		for (auto& stage : rec.stages)
+			ofs << baselineKey(rec.image, rec.method, stage.first) << ','
+				<< percentile(stage.second, 0.5f) << "\n";
+
+}
+
+double Benchmark::percentile(std::vector<double> samples, float p) {
+
+	if (samples.empty())
+		return 0.0;
+
+	std::sort(samples.begin(), samples.end());
+	size_t rank = size_t(std::ceil(p * samples.size()));
+	return samples[std::min(samples.size() - 1, rank > 0 ? rank - 1 : 0)];
+
+}
+
+std::string Benchmark::sizeBucket(const cv::Size& size) {
+
+	double mp = double(size.width) * size.height / 1e6;
+	if (mp < 0.25)
+		return "<0.25MP";
+	if (mp < 1.0)
+		return "0.25-1MP";
+	if (mp < 4.0)
+		return "1-4MP";
+	return ">4MP";
+
+}
+
+int Benchmark::report() {
+
+	int regressions = 0;
+	std::ofstream ofs(dstDir + "benchmark.csv");
+	ofs << "Test,Method,Size,Stage,Median,P95,Baseline,IoU\n";
+
+	std::map<std::string, StageSamples> bySize;
+
+	for (auto& rec : records) {
+
+		// Outputs written as the new references are accepted as they are
+		if (!updateBaseline && rec.iou == NO_REFERENCE) {
+			std::cout << "REGRESSION " << rec.image << " " << rec.method
+				<< ": no reference mask, run mode 3 to store one" << std::endl;
+			regressions++;
+		}
+		else if (!updateBaseline && rec.iou < minIoU) {
+			std::cout << "REGRESSION " << rec.image << " " << rec.method
+				<< ": IoU " << rec.iou << " < " << minIoU << std::endl;
+			regressions++;
+		}
+
+		std::string iou = (rec.iou == NO_REFERENCE ? "none" : std::to_string(rec.iou));
+
+		for (auto& stage : rec.stages) {
+
+			double median = percentile(stage.second, 0.5f);
+			double p95 = percentile(stage.second, 0.95f);
+			auto it = baseline.find(baselineKey(rec.image, rec.method, stage.first));
+			double base = (it == baseline.end() ? -1.0 : it->second);
+
+			ofs << rec.image << ',' << rec.method << ',' << rec.size.width << 'x' << rec.size.height << ','
+				<< stage.first << ',' << median << ',' << p95 << ',' << base << ',' << iou << "\n";
+
+			// Ignore sub-millisecond noise on tiny stages
+			if (base > 0 && median > base * (1.0 + tolerance) && median - base > 1e-3) {
+				std::cout << "REGRESSION " << rec.image << " " << rec.method << " " << stage.first
+					<< ": " << median << "s vs baseline " << base << "s" << std::endl;
+				regressions++;
+			}
+
+			auto& bucket = bySize[sizeBucket(rec.size) + " " + rec.method][stage.first];
+			bucket.insert(bucket.end(), stage.second.begin(), stage.second.end());
+		}
+	}
+
+	std::cout << "size method stage: median p95 (seconds)" << std::endl;
+	for (auto& group : bySize)
+		for (auto& stage : group.second)
+			std::cout << group.first << " " << stage.first << ": "
+				<< percentile(stage.second, 0.5f) << " "
+				<< percentile(stage.second, 0.95f) << std::endl;
+
+	std::cout << regressions << " regression(s) flagged" << std::endl;
+	return regressions;
+
+}
+
+int Benchmark::run(const std::vector<std::string>& inputList) {
+
+	records.clear();
+	loadBaseline();
+
+	for (auto& fileName : inputList) {
+
+		cv::Mat img = cv::imread(srcDir + fileName + ".jpg");
+		if (img.empty()) {
+			std::cout << fileName << " Image reading error!\n";
+			continue;
+		}
+
+		cv::Mat seedMask = cv::Mat::zeros(img.size(), CV_8S);
+		std::vector<cv::Point> hintBkg, hintObj;
+		if (!loadHint(fileName, seedMask, hintBkg, hintObj)) {
+			std::cout << fileName << " Hint file missing error!\n";
+			continue;
+		}
+
+		std::cout << "benchmarking " << fileName << std::endl;
+
+		Record gcRec{ fileName, "graphcut", img.size() };
+		Record lsRec{ fileName, "lazy", img.size() };
+		Record cachedRec{ fileName, "lazy_cached", img.size() };
+		Record hybridRec{ fileName, "hybrid", img.size() };
+		cv::Mat gcMask, lsMask, cachedMask, hybridMask;
+
+		// Untimed run that fills the superpixel cache for the warm runs
+		Record warmUp;
+		superpixelCache.clear();
+		runLazySnapping(img, hintBkg, hintObj, warmUp, cachedMask, fileName);
+
+		for (int i = 0; i < repeats; i++) {
+			runGraphCut(img, seedMask, gcRec, gcMask);
+			runLazySnapping(img, hintBkg, hintObj, lsRec, lsMask);
+			runLazySnapping(img, hintBkg, hintObj, cachedRec, cachedMask, fileName);
+			runHybrid(img, hintBkg, hintObj, hybridRec, hybridMask);
+		}
+
+		gcRec.iou = checkMask(gcRec, gcMask);
+		lsRec.iou = checkMask(lsRec, lsMask);
+		cachedRec.iou = checkMask(cachedRec, cachedMask);
+		hybridRec.iou = checkMask(hybridRec, hybridMask);
+
+		records.push_back(gcRec);
+		records.push_back(lsRec);
+		records.push_back(cachedRec);
+		records.push_back(hybridRec);
+	}
+
+	if (baseline.empty() && !updateBaseline)
+		std::cout << "no baseline timings in " << dstDir << ", run mode 3 to store them" << std::endl;
+
+	int regressions = report();
+
+	if (updateBaseline)
+		saveBaseline();
+
+	return regressions;
+
+}
@@ -0,0 +1,118 @@
+#ifndef BENCHMARK_H_
+#define BENCHMARK_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2\opencv.hpp>
+#include "..\lazy\SuperpixelCache.h"
+
+// Repeated, seeded runs of the segmenters over a dataset list.
+// Reports median/p95 per stage and per image size, checks masks against
+// stored references and flags regressions against a stored baseline.
+class Benchmark {
+
+public:
+
+	Benchmark(const std::string& srcDir, const std::string& dstDir);
+
+	void setRepeats(int);
+
+	void setSeed(uint64_t);
+
+	// Relative slow-down of a stage median that counts as a regression
+	void setTolerance(float);
+
+	// Minimum IoU against the reference mask
+	void setMinIoU(float);
+
+	// Overwrite the stored baseline timings and reference masks. Without it
+	// nothing is written and a missing reference mask is a regression.
+	void setUpdateBaseline(bool);
+
+	// Returns the number of flagged regressions
+	int run(const std::vector<std::string>& inputList);
+
+private:
+
+	typedef std::map<std::string, std::vector<double>> StageSamples;
+
+	// IoU of a record without a stored reference mask
+	static const double NO_REFERENCE;
+
+	struct Record {
+		std::string		image;
+		std::string		method;
+		cv::Size		size;
+		StageSamples	stages;
+		double			iou;
+	};
+
+	std::string					srcDir, dstDir;
+	int							repeats;
+	uint64_t					seed;
+	float						tolerance;
+	float						minIoU;
+	bool						updateBaseline;
+
+	SuperpixelCache				superpixelCache;
+
+	std::vector<Record>			records;
+	std::map<std::string, double>	baseline;
+
+	bool						loadHint(const std::string& fileName, cv::Mat& seedMask,
+									std::vector<cv::Point>& hintBkg, std::vector<cv::Point>& hintObj);
+
+	void						runGraphCut(const cv::Mat& img, const cv::Mat& seedMask, Record& rec, cv::Mat& mask);
+
+	// With a cache key the superpixels come from superpixelCache
+	void						runLazySnapping(const cv::Mat& img, const std::vector<cv::Point>& hintBkg,
+									const std::vector<cv::Point>& hintObj, Record& rec, cv::Mat& mask,
+									const std::string& cacheKey = "");
+
+	void						runHybrid(const cv::Mat& img, const std::vector<cv::Point>& hintBkg,
+									const std::vector<cv::Point>& hintObj, Record& rec, cv::Mat& mask);
+
+	double						checkMask(const Record& rec, const cv::Mat& mask);
+
+	void						loadBaseline();
+
+	void						saveBaseline();
+
+	int							report();
+
+	static double				percentile(std::vector<double> samples, float p);
+
+	static std::string			sizeBucket(const cv::Size& size);
+
+	static std::string			baselineKey(const std::string& image, const std::string& method, const std::string& stage);
+
+};
+
+inline void Benchmark::setRepeats(int _repeats) {
+	repeats = std::max(1, _repeats);
+}
+
+inline void Benchmark::setSeed(uint64_t _seed) {
+	seed = _seed;
+}
+
+inline void Benchmark::setTolerance(float _tolerance) {
+	tolerance = _tolerance;
+}
+
+inline void Benchmark::setMinIoU(float _minIoU) {
+	minIoU = _minIoU;
+}
+
+inline void Benchmark::setUpdateBaseline(bool _update) {
+	updateBaseline = _update;
+}
+
+inline std::string Benchmark::baselineKey(const std::string& image, const std::string& method, const std::string& stage) {
+	return image + ',' + method + ',' + stage;
+}
+
+#endif /* BENCHMARK_H_ */
@@ -0,0 +1,100 @@
+#include "GridGenerator.h"
+#include <cmath>
+
+const int GridGenerator::neighbors[4][2] = {
+	{ 1, 0 }, { 0, 1 }, { 1, 1 }, { -1, 1 }
+};
+
+// Blobs live on a jittered grid of cells, at most one per cell,
+// so a pixel only has to test the 3x3 cells around it
+static const int BLOB_CELL = 64;
+
+// Spacing of the two line families of the THIN pattern
+static const float LINE_SPACING = 23.0f;
+
+GridGenerator::GridGenerator(int _width, int _height, Pattern _pattern, uint32_t _seed)
+	: width(_width), height(_height), pattern(_pattern), seed(_seed) {
+	setNLink(10.0f, 0.1f);
+	setTLink(4.0f, 0.5f);
+}
+
+const char* GridGenerator::patternName(Pattern p) {
+	switch (p) {
+	case NOISE:
+		return "noise";
+	case BLOBS:
+		return "blobs";
+	case THIN:
+		return "thin";
+	}
+	return "unknown";
+}
+
+bool GridGenerator::insideBlob(int x, int y) const {
+
+	int cx = x / BLOB_CELL, cy = y / BLOB_CELL;
+
+	for (int j = cy - 1; j <= cy + 1; j++) {
+		for (int i = cx - 1; i <= cx + 1; i++) {
+
+			if (random(i, j, 1) > 0.6f)
+				continue;
+
+			float bx = (i + random(i, j, 2)) * BLOB_CELL;
+			float by = (j + random(i, j, 3)) * BLOB_CELL;
+			float r = 8.0f + random(i, j, 4) * (BLOB_CELL / 2 - 8);
+
+			if ((x - bx) * (x - bx) + (y - by) * (y - by) <= r * r)
+				return true;
+		}
+	}
+
+	return false;
+}
+
+bool GridGenerator::onLine(int x, int y) const {
+
+	// Two families of parallel lines at roughly 30 and 110 degrees
+	const float a1 = 0.866f, b1 = 0.5f;
+	const float a2 = -0.342f, b2 = 0.940f;
+
+	float d1 = std::fmod(std::fabs(a1 * x + b1 * y), LINE_SPACING);
+	float d2 = std::fmod(std::fabs(a2 * x + b2 * y), LINE_SPACING);
+
+	return d1 < 1.5f || d2 < 1.0f;
+}
+
+bool GridGenerator::label(int x, int y) const {
+
+	switch (pattern) {
+	case NOISE:
+		return random(x, y, 5) < 0.5f;
+	case BLOBS:
+		return insideBlob(x, y);
+	case THIN:
+		return onLine(x, y);
+	}
+
+	return false;
+}
+
+float GridGenerator::nlink(int x, int y, int dir) const {
+
+	int nx = x + neighbors[dir][0], ny = y + neighbors[dir][1];
+
+	float w = nStrength * (0.5f + random(x, y, 10 + dir));
+	if (label(x, y) != label(nx, ny))
+		w *= nContrast;
+
+	// Diagonal neighbours are sqrt(2) apart, as in GraphCutSegmentation
+	return dir >= 2 ? w * 0.70710678f : w;
+}
+
+void GridGenerator::tlink(int x, int y, float& toSource, float& toSink) const {
+
+	float d = (label(x, y) ? 1.0f : -1.0f) + tNoise * (4.0f * random(x, y, 20) - 2.0f);
+	d *= tStrength;
+
+	toSource = d > 0 ? d : 0.0f;
+	toSink = d < 0 ? -d : 0.0f;
+}
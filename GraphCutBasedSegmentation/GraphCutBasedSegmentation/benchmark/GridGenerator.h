@@ -0,0 +1,98 @@
+#ifndef GRID_GENERATOR_H_
+#define GRID_GENERATOR_H_
+
+#include <cstdint>
+
+// Synthetic 8-connected grid graphs of arbitrary size for max_flow benchmarks.
+// Every weight is a pure function of (x, y, seed), so nothing is stored and
+// graphs far larger than our real images can be streamed into a solver.
+class GridGenerator {
+
+public:
+
+	enum Pattern {
+		NOISE,		// independent per-pixel labels
+		BLOBS,		// scattered discs of varying radius
+		THIN		// crossing 1-2 pixel wide lines
+	};
+
+	// Offsets of the forward neighbours: right, down, down-right, down-left
+	static const int neighbors[4][2];
+
+	GridGenerator(int width, int height, Pattern pattern, uint32_t seed = 1);
+
+	// n-link weight inside a region and its attenuation across a boundary
+	void setNLink(float strength, float contrast);
+
+	// t-link magnitude and the amount of label noise in [0, 1]
+	void setTLink(float strength, float noise);
+
+	int getWidth() const;
+
+	int getHeight() const;
+
+	Pattern getPattern() const;
+
+	static const char* patternName(Pattern);
+
+	// Ground-truth region the t-links are drawn towards
+	bool label(int x, int y) const;
+
+	float nlink(int x, int y, int dir) const;
+
+	void tlink(int x, int y, float& toSource, float& toSink) const;
+
+private:
+
+	int			width, height;
+	Pattern		pattern;
+	uint32_t	seed;
+
+	float		nStrength, nContrast;
+	float		tStrength, tNoise;
+
+	// Uniform in [0, 1), a hash of the coordinates
+	float		random(int x, int y, uint32_t salt) const;
+
+	bool		insideBlob(int x, int y) const;
+
+	bool		onLine(int x, int y) const;
+
+};
+
+inline int GridGenerator::getWidth() const {
+	return width;
+}
+
+inline int GridGenerator::getHeight() const {
+	return height;
+}
+
+inline GridGenerator::Pattern GridGenerator::getPattern() const {
+	return pattern;
+}
+
+inline void GridGenerator::setNLink(float strength, float contrast) {
+	nStrength = strength;
+	nContrast = contrast;
+}
+
+inline void GridGenerator::setTLink(float strength, float noise) {
+	tStrength = strength;
+	tNoise = noise;
+}
+
+inline float GridGenerator::random(int x, int y, uint32_t salt) const {
+	uint32_t h = seed ^ (salt * 0x9E3779B9u);
+	h ^= uint32_t(x) * 0x85EBCA6Bu;
+	h = (h << 13) | (h >> 19);
+	h ^= uint32_t(y) * 0xC2B2AE35u;
+	h ^= h >> 16;
+	h *= 0x7FEB352Du;
+	h ^= h >> 15;
+	h *= 0x846CA68Bu;
+	h ^= h >> 16;
+	return (h >> 8) * (1.0f / 16777216.0f);
+}
+
+#endif /* GRID_GENERATOR_H_ */
@@ -0,0 +1,211 @@
+#include "MaxflowBenchmark.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include "..\max_flow\graph.h"
+#include "..\max_flow\ibfs.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(const Clock::time_point& start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+MaxflowBenchmark::MaxflowBenchmark() {
+	setRepeats(3);
+	setReuseFraction(0.01f);
+	setFlipPattern(CLUSTERED);
+}
+
+const char* MaxflowBenchmark::flipName(FlipPattern p) {
+	switch (p) {
+	case STRIDE:
+		return "stride";
+	case CLUSTERED:
+		return "clustered";
+	}
+	return "unknown";
+}
+
+void MaxflowBenchmark::flipNodes(int width, int height, int iter, std::vector<int>& nodes) const {
+
+	nodes.clear();
+	float fraction = std::min(1.0f, std::max(reuseFraction, 1e-6f));
+
+	if (flipPattern == STRIDE) {
+		int step = std::max(1, int(1.0f / fraction));
+		for (int node = iter % step; node < width * height; node += step)
+			nodes.push_back(node);
+		return;
+	}
+
+	// One block of side x side nodes per cell, the cell sized so that the
+	// blocks cover the fraction
+	const int side = 8;
+	int cell = std::max(side, int(side / std::sqrt(fraction)));
+	int offset = (iter * 3) % (cell - side + 1);
+
+	for (int cy = 0; cy < height; cy += cell) {
+		for (int cx = 0; cx < width; cx += cell) {
+			int y1 = std::min(height, cy + offset + side);
+			int x1 = std::min(width, cx + offset + side);
+			for (int y = cy + offset; y < y1; y++)
+				for (int x = cx + offset; x < x1; x++)
+					nodes.push_back(y * width + x);
+		}
+	}
+
+}
+
+double MaxflowBenchmark::median(std::vector<double> samples) {
+	std::sort(samples.begin(), samples.end());
+	return samples.empty() ? 0.0 : samples[samples.size() / 2];
+}
+
+void MaxflowBenchmark::writeHeader(std::ostream& out) {
+	out << "Pattern,Width,Height,Solver,Type,Flip,Build,Maxflow,Reuse,Flow,ReuseFlow,Check\n";
+}
+
+template <template <typename, typename, typename> class GraphTemplate,
+	typename captype, typename tcaptype, typename flowtype>
+int MaxflowBenchmark::runType(const char* solverName, const char* typeName, const GridGenerator& gen, float scale, std::ostream& out) {
+
+	typedef GraphTemplate<captype, tcaptype, flowtype> GraphType;
+
+	int width = gen.getWidth(), height = gen.getHeight();
+	int numNodes = width * height;
+	int numEdges = numNodes * 4;
+
+	// Weights are generated up front so that only the solver is timed
+	std::vector<captype> nlinks(size_t(numNodes) * 4, captype(-1));
+	std::vector<tcaptype> toSource(numNodes), toSink(numNodes);
+
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+
+			int node = y * width + x;
+			for (int dir = 0; dir < 4; dir++) {
+				int nx = x + GridGenerator::neighbors[dir][0];
+				int ny = y + GridGenerator::neighbors[dir][1];
+				if (nx >= 0 && nx < width && ny < height)
+					nlinks[size_t(node) * 4 + dir] = captype(gen.nlink(x, y, dir) * scale);
+			}
+
+			float s, t;
+			gen.tlink(x, y, s, t);
+			toSource[node] = tcaptype(s * scale);
+			toSink[node] = tcaptype(t * scale);
+		}
+	}
+
+	auto build = [&](const std::vector<tcaptype>& source, const std::vector<tcaptype>& sink) {
+		GraphType* g = new GraphType(numNodes, numEdges);
+		g->add_node(numNodes);
+
+		for (int node = 0; node < numNodes; node++) {
+			const captype* w = &nlinks[size_t(node) * 4];
+			for (int dir = 0; dir < 4; dir++) {
+				if (w[dir] >= 0)
+					g->add_edge(node, node + GridGenerator::neighbors[dir][1] * width + GridGenerator::neighbors[dir][0], w[dir], w[dir]);
+			}
+			g->add_tweights(node, source[node], sink[node]);
+		}
+		return g;
+	};
+
+	// Float flows depend on the order of the augmentations
+	const double tolerance = std::numeric_limits<flowtype>::is_integer ? 0.0 : std::sqrt(double(std::numeric_limits<flowtype>::epsilon()));
+
+	std::vector<double> buildTime, flowTime, reuseTime;
+	std::vector<int> flipped;
+	flowtype flow = 0, reuseFlow = 0;
+	int failures = 0;
+
+	for (int iter = 0; iter < repeats; iter++) {
+
+		// Construction
+		auto start = Clock::now();
+		std::unique_ptr<GraphType> g(build(toSource, toSink));
+		buildTime.push_back(secondsSince(start));
+
+		// Full solve
+		start = Clock::now();
+		flow = g->maxflow();
+		flowTime.push_back(secondsSince(start));
+
+		// Flip the t-links of a subset of nodes and re-solve with the
+		// search trees of the previous call
+		std::vector<tcaptype> flippedSource(toSource), flippedSink(toSink);
+		flipNodes(width, height, iter, flipped);
+		for (int node : flipped) {
+			tcaptype delta = toSink[node] - toSource[node];
+			g->add_tweights(node, delta, -delta);
+			g->mark_node(node);
+			flippedSource[node] += delta;
+			flippedSink[node] -= delta;
+		}
+
+		start = Clock::now();
+		reuseFlow = g->maxflow(true);
+		reuseTime.push_back(secondsSince(start));
+		g.reset();
+
+		// Same flips on top of a solve that was interrupted, resumed with
+		// interruptions a few times before it is allowed to finish
+		std::atomic<bool> cancel(true);
+		g.reset(build(toSource, toSink));
+		g->set_interrupt(&cancel);
+		g->maxflow();
+		for (int node : flipped) {
+			tcaptype delta = toSink[node] - toSource[node];
+			g->add_tweights(node, delta, -delta);
+			g->mark_node(node);
+		}
+		flowtype resumeFlow = g->maxflow(true);
+		for (int k = 0; k < 3 && !g->is_optimal(); k++)
+			resumeFlow = g->maxflow(true);
+		cancel = false;
+		if (!g->is_optimal())
+			resumeFlow = g->maxflow(true);
+		g.reset();
+
+		// Reusing the trees must not change the answer
+		std::unique_ptr<GraphType> fresh(build(flippedSource, flippedSink));
+		double expected = double(fresh->maxflow());
+		double limit = tolerance * std::max(1.0, std::abs(expected));
+		if (std::abs(double(reuseFlow) - expected) > limit || std::abs(double(resumeFlow) - expected) > limit)
+			failures++;
+	}
+
+	out << GridGenerator::patternName(gen.getPattern()) << ',' << width << ',' << height << ','
+		<< solverName << ',' << typeName << ',' << flipName(flipPattern) << ',' << median(buildTime) << ','
+		<< median(flowTime) << ',' << median(reuseTime) << ',' << double(flow) << ',' << double(reuseFlow) << ','
+		<< (failures ? "FAIL" : "ok") << "\n";
+	out.flush();
+
+	return failures;
+
+}
+
+template <template <typename, typename, typename> class GraphTemplate>
+int MaxflowBenchmark::runSolver(const char* solverName, const GridGenerator& gen, std::ostream& out) {
+
+	// Integer capacities are the float weights scaled to keep some precision.
+	// The scales are kept small since an int flow overflows on very large grids.
+	int failures = 0;
+	failures += runType<GraphTemplate, int, int, int>(solverName, "int", gen, 100.0f, out);
+	failures += runType<GraphTemplate, short, int, int>(solverName, "short", gen, 10.0f, out);
+	failures += runType<GraphTemplate, float, float, float>(solverName, "float", gen, 1.0f, out);
+	failures += runType<GraphTemplate, double, double, double>(solverName, "double", gen, 1.0f, out);
+	return failures;
+
+}
+
+int MaxflowBenchmark::run(const GridGenerator& gen, std::ostream& out) {
+
+	return runSolver<Graph>("bk", gen, out) + runSolver<IBFSGraph>("ibfs", gen, out);
+
+}
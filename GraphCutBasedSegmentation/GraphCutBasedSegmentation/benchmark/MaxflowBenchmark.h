@@ -0,0 +1,73 @@
+#ifndef MAXFLOW_BENCHMARK_H_
+#define MAXFLOW_BENCHMARK_H_
+
+#include <algorithm>
+#include <ostream>
+#include <vector>
+#include "GridGenerator.h"
+
+// Times graph construction, a full maxflow and a reuse-trees re-solve on
+// synthetic grids for every solver and capacity type instantiated in
+// graph.cpp and ibfs.cpp. The re-solve, and the same flips resumed on top
+// of an interrupted solve, are checked against a fresh solve of the
+// flipped graph.
+class MaxflowBenchmark {
+
+public:
+
+	enum FlipPattern {
+		STRIDE,		// every n-th node, flipped nodes are never neighbours
+		CLUSTERED	// square blocks, most flipped nodes have flipped neighbours
+	};
+
+	MaxflowBenchmark();
+
+	void setRepeats(int);
+
+	// Fraction of nodes whose t-links are flipped before the re-solve
+	void setReuseFraction(float);
+
+	void setFlipPattern(FlipPattern);
+
+	static const char* flipName(FlipPattern);
+
+	// Writes one CSV row per solver and capacity type:
+	// pattern,width,height,solver,type,flip,build,maxflow,reuse,flow,reuseflow,check
+	// Returns the number of re-solves whose flow differs from a fresh solve.
+	int run(const GridGenerator& gen, std::ostream& out);
+
+	static void writeHeader(std::ostream& out);
+
+private:
+
+	int			repeats;
+	float		reuseFraction;
+	FlipPattern	flipPattern;
+
+	// Nodes flipped before the re-solve of repeat iter
+	void flipNodes(int width, int height, int iter, std::vector<int>& nodes) const;
+
+	template <template <typename, typename, typename> class GraphTemplate,
+		typename captype, typename tcaptype, typename flowtype>
+	int runType(const char* solverName, const char* typeName, const GridGenerator& gen, float scale, std::ostream& out);
+
+	template <template <typename, typename, typename> class GraphTemplate>
+	int runSolver(const char* solverName, const GridGenerator& gen, std::ostream& out);
+
+	static double median(std::vector<double> samples);
+
+};
+
+inline void MaxflowBenchmark::setRepeats(int _repeats) {
+	repeats = std::max(1, _repeats);
+}
+
+inline void MaxflowBenchmark::setReuseFraction(float _fraction) {
+	reuseFraction = _fraction;
+}
+
+inline void MaxflowBenchmark::setFlipPattern(FlipPattern _pattern) {
+	flipPattern = _pattern;
+}
+
+#endif /* MAXFLOW_BENCHMARK_H_ */
@@ -0,0 +1,155 @@
+#include "ColorModel.h"
+#include <cfloat>
+
+static int nearestCenter(const cv::Mat& centers, const cv::Vec3f& pix, float& bestDist) {
+	int best = 0;
+	bestDist = FLT_MAX;
+	for (int c = 0; c < centers.rows; c++) {
+		const float* center = centers.ptr<float>(c);
+		float d0 = pix[0] - center[0], d1 = pix[1] - center[1], d2 = pix[2] - center[2];
+		float dist = d0 * d0 + d1 * d1 + d2 * d2;
+		if (dist < bestDist) {
+			bestDist = dist;
+			best = c;
+		}
+	}
+	return best;
+}
+
+ColorModel::ColorModel() {
+	setClusterNumber(20);
+	setSeed(0x12345678);
+	setTermCriteria(cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 50, 1.0));
+	reset();
+}
+
+void ColorModel::reset() {
+	centers.release();
+	counts.clear();
+}
+
+void ColorModel::fit(const cv::Mat& samples, cv::Mat& labels) {
+
+	if (samples.rows == 0) {
+		reset();
+		labels.release();
+		return;
+	}
+
+	int k = std::min(clusters, samples.rows);
+
+	// kmeans draws its initial centres from theRNG(), leave it as it was for everyone else
+	cv::RNG& rng = cv::theRNG();
+	uint64_t callerState = rng.state;
+	rng.state = seed;
+
+	cv::kmeans(samples, k, labels, criteria, 1, cv::KMEANS_RANDOM_CENTERS, centers);
+
+	rng.state = callerState;
+
+	counts.assign(k, 0.0);
+	for (int i = 0; i < labels.rows; i++)
+		counts[labels.at<int>(i, 0)] += 1.0;
+
+}
+
+void ColorModel::addSamples(const cv::Mat& samples) {
+
+	if (samples.rows == 0)
+		return;
+
+	if (centers.empty()) {
+		cv::Mat labels;
+		fit(samples, labels);
+		return;
+	}
+
+	refine(samples);
+
+}
+
+void ColorModel::refine(const cv::Mat& samples) {
+
+	int oldCenters = centers.rows;
+	int k = std::min(clusters, oldCenters + samples.rows);
+
+	// Until there are enough clusters the new samples farthest from the
+	// current centres open new ones
+	std::vector<float> gap(samples.rows);
+	for (int i = 0; i < samples.rows; i++)
+		nearestCenter(centers, samples.at<cv::Vec3f>(i, 0), gap[i]);
+
+	for (int c = oldCenters; c < k; c++) {
+		int farthest = int(std::max_element(gap.begin(), gap.end()) - gap.begin());
+		cv::Mat center(1, 3, CV_32F);
+		const cv::Vec3f& pix = samples.at<cv::Vec3f>(farthest, 0);
+		for (int d = 0; d < 3; d++)
+			center.at<float>(0, d) = pix[d];
+		centers.push_back(center);
+		counts.push_back(0.0);
+		gap[farthest] = -1.0f;
+	}
+
+	// Each old centre stands in for the samples it already holds
+	cv::Mat anchors = centers.rowRange(0, oldCenters).clone();
+	std::vector<double> anchorWeights(counts.begin(), counts.begin() + oldCenters);
+
+	std::vector<int> samplesLabel(samples.rows), anchorsLabel(oldCenters);
+	int maxIter = (criteria.type & cv::TermCriteria::MAX_ITER) ? criteria.maxCount : 100;
+	double epsilon = (criteria.type & cv::TermCriteria::EPS) ? criteria.epsilon : 0.0;
+
+	for (int iter = 0; iter < maxIter; iter++) {
+
+		float dist;
+		for (int i = 0; i < oldCenters; i++) {
+			const float* a = anchors.ptr<float>(i);
+			anchorsLabel[i] = nearestCenter(centers, cv::Vec3f(a[0], a[1], a[2]), dist);
+		}
+		for (int i = 0; i < samples.rows; i++)
+			samplesLabel[i] = nearestCenter(centers, samples.at<cv::Vec3f>(i, 0), dist);
+
+		std::vector<cv::Vec3d> sums(k, cv::Vec3d(0, 0, 0));
+		std::vector<double> weights(k, 0.0);
+		for (int i = 0; i < oldCenters; i++) {
+			const float* a = anchors.ptr<float>(i);
+			sums[anchorsLabel[i]] += anchorWeights[i] * cv::Vec3d(a[0], a[1], a[2]);
+			weights[anchorsLabel[i]] += anchorWeights[i];
+		}
+		for (int i = 0; i < samples.rows; i++) {
+			const cv::Vec3f& pix = samples.at<cv::Vec3f>(i, 0);
+			sums[samplesLabel[i]] += cv::Vec3d(pix[0], pix[1], pix[2]);
+			weights[samplesLabel[i]] += 1.0;
+		}
+
+		// Same stopping rule as cv::kmeans, the largest squared centre shift
+		double shift = 0.0;
+		for (int c = 0; c < k; c++) {
+			// An empty cluster keeps its centre
+			if (weights[c] <= 0)
+				continue;
+			float* center = centers.ptr<float>(c);
+			double moved = 0.0;
+			for (int d = 0; d < 3; d++) {
+				double value = sums[c][d] / weights[c];
+				moved += (value - center[d]) * (value - center[d]);
+				center[d] = (float)value;
+			}
+			shift = std::max(shift, moved);
+		}
+		counts = weights;
+
+		if (shift <= epsilon * epsilon)
+			break;
+	}
+
+}
+
+void ColorModel::predict(const cv::Mat& samples, cv::Mat& labels) const {
+
+	labels.create(samples.rows, 1, CV_32S);
+
+	float dist;
+	for (int i = 0; i < samples.rows; i++)
+		labels.at<int>(i, 0) = nearestCenter(centers, samples.at<cv::Vec3f>(i, 0), dist);
+
+}
@@ -0,0 +1,85 @@
+#ifndef COLOR_MODEL_H_
+#define COLOR_MODEL_H_
+
+#include <cstdint>
+#include <vector>
+#include <opencv2\opencv.hpp>
+
+// k-means colour clusters with an explicit RNG seed, so that the same samples
+// always give the same centres. addSamples() updates the clusters online from
+// new samples only, the earlier ones are summarised by the weighted centres.
+class ColorModel {
+
+public:
+
+	ColorModel();
+
+	void setClusterNumber(int);
+
+	void setSeed(uint64_t);
+
+	void setTermCriteria(const cv::TermCriteria&);
+
+	// Cold start. samples are N x 1 CV_32FC3, labels receive N x 1 CV_32S
+	void fit(const cv::Mat& samples, cv::Mat& labels);
+
+	// Streaming update, the first call is a cold fit. samples are M x 1 CV_32FC3
+	void addSamples(const cv::Mat& samples);
+
+	// Nearest centre of each sample
+	void predict(const cv::Mat& samples, cv::Mat& labels) const;
+
+	void reset();
+
+	// k x 3 CV_32F, k is at most the number of samples
+	const cv::Mat& getCenters() const;
+
+	int getClusterNumber() const;
+
+	// Samples seen since the last fit or reset
+	double getSampleCount() const;
+
+private:
+
+	int							clusters;
+	uint64_t					seed;
+	cv::TermCriteria			criteria;
+
+	cv::Mat						centers;
+
+	// Samples behind each centre
+	std::vector<double>			counts;
+
+	// Weighted Lloyd iterations over the old centres and the new samples
+	void						refine(const cv::Mat& samples);
+
+};
+
+inline void ColorModel::setClusterNumber(int _clusters) {
+	clusters = std::max(1, _clusters);
+}
+
+inline void ColorModel::setSeed(uint64_t _seed) {
+	seed = _seed;
+}
+
+inline void ColorModel::setTermCriteria(const cv::TermCriteria& _criteria) {
+	criteria = _criteria;
+}
+
+inline const cv::Mat& ColorModel::getCenters() const {
+	return centers;
+}
+
+inline int ColorModel::getClusterNumber() const {
+	return centers.rows;
+}
+
+inline double ColorModel::getSampleCount() const {
+	double total = 0;
+	for (double count : counts)
+		total += count;
+	return total;
+}
+
+#endif /* COLOR_MODEL_H_ */
@@ -0,0 +1,113 @@
+#include "FeaturePlanes.h"
+
+FeaturePlanes::FeaturePlanes() : width(0), height(0) {
+	setColorSpace(BGR);
+	setGradient(false);
+	setStatisticsStep(1);
+	setStatisticsRoi(cv::Rect());
+}
+
+void FeaturePlanes::addStatisticsRow(const uchar* pix, int begin, int end) {
+
+	// 8-bit input keeps the row sums exact in integers
+	int64 sum[3] = { 0, 0, 0 }, sumSqr[3] = { 0, 0, 0 };
+	int n = 0;
+	for (int x = begin; x < end; x += statisticsStep, n++) {
+		const uchar* p = pix + 3 * x;
+		sum[0] += p[0];
+		sum[1] += p[1];
+		sum[2] += p[2];
+		sumSqr[0] += p[0] * p[0];
+		sumSqr[1] += p[1] * p[1];
+		sumSqr[2] += p[2] * p[2];
+	}
+
+	if (n == 0)
+		return;
+
+	// Merge the row into the running statistics (Chan et al.), stable
+	// where a plain sum of squares over the whole image would cancel
+	double total = statisticsCount + n;
+	for (int c = 0; c < 3; c++) {
+		double rowMean = double(sum[c]) / n;
+		double rowM2 = double(sumSqr[c]) - double(sum[c]) * rowMean;
+		double delta = rowMean - mean[c];
+		mean[c] += delta * n / total;
+		m2[c] += rowM2 + delta * delta * statisticsCount * n / total;
+	}
+	statisticsCount = total;
+
+}
+
+void FeaturePlanes::compute(const cv::Mat& img) {
+
+	CV_Assert(img.type() == CV_8UC3);
+
+	cv::Mat color = img;
+	if (colorSpace == LAB)
+		cv::cvtColor(img, color, cv::COLOR_BGR2Lab);
+
+	width = img.cols;
+	height = img.rows;
+
+	int stride = (width + 15) / 16 * 16;
+	planeData.create(3 * height, stride, CV_32F);
+	planes.resize(3);
+	for (int c = 0; c < 3; c++)
+		planes[c] = planeData(cv::Rect(0, c * height, width, height));
+
+	samples.create(width * height, 1, CV_32FC3);
+
+	cv::Rect roi(0, 0, width, height);
+	if (statisticsRoi.area() > 0)
+		roi &= statisticsRoi;
+
+	statisticsCount = 0;
+	mean = m2 = cv::Vec3d(0, 0, 0);
+
+	// One pass writes both layouts
+	for (int y = 0; y < height; y++) {
+		const uchar* pix = color.ptr<uchar>(y);
+		float* p0 = planes[0].ptr<float>(y);
+		float* p1 = planes[1].ptr<float>(y);
+		float* p2 = planes[2].ptr<float>(y);
+		float* sample = samples.ptr<float>(y * width);
+		for (int x = 0; x < width; x++, pix += 3, sample += 3) {
+			p0[x] = sample[0] = pix[0];
+			p1[x] = sample[1] = pix[1];
+			p2[x] = sample[2] = pix[2];
+		}
+
+		if (y >= roi.y && y < roi.y + roi.height && (y - roi.y) % statisticsStep == 0)
+			addStatisticsRow(color.ptr<uchar>(y), roi.x, roi.x + roi.width);
+	}
+
+	for (int c = 0; c < 3; c++)
+		variance[c] = statisticsCount > 0 ? m2[c] / statisticsCount : 0.0;
+
+	if (gradient)
+		computeGradient();
+	else
+		gradientPlane.release();
+
+}
+
+void FeaturePlanes::computeGradient() {
+
+	gradientPlane = cv::Mat::zeros(height, width, CV_32F);
+
+	for (int y = 1; y + 1 < height; y++) {
+		float* out = gradientPlane.ptr<float>(y);
+		for (int c = 0; c < 3; c++) {
+			const float* up = getRow(c, y - 1);
+			const float* mid = getRow(c, y);
+			const float* down = getRow(c, y + 1);
+			for (int x = 1; x + 1 < width; x++) {
+				float dx = 0.5f * (mid[x + 1] - mid[x - 1]);
+				float dy = 0.5f * (down[x] - up[x]);
+				out[x] = std::max(out[x], std::sqrt(dx * dx + dy * dy));
+			}
+		}
+	}
+
+}
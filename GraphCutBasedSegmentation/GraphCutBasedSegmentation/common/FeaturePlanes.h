@@ -0,0 +1,151 @@
+#ifndef FEATURE_PLANES_H_
+#define FEATURE_PLANES_H_
+
+#include <vector>
+#include <opencv2\opencv.hpp>
+
+// An 8-bit BGR image converted once into per-channel float planes. Colour
+// statistics, clustering and n-links all read from here instead of
+// converting pixels on the fly. Plane rows are padded to 16 floats so that
+// every row starts on a 64-byte boundary. The per-channel mean and variance
+// are gathered in the same pass.
+class FeaturePlanes {
+
+public:
+
+	enum ColorSpace {
+		BGR,
+		LAB
+	};
+
+	FeaturePlanes();
+
+	void setColorSpace(ColorSpace);
+
+	// Also compute the gradient magnitude plane
+	void setGradient(bool);
+
+	// Gather the statistics on every step-th row and column only
+	void setStatisticsStep(int);
+
+	// Gather the statistics inside roi only, an empty rect means the whole image
+	void setStatisticsRoi(const cv::Rect&);
+
+	void compute(const cv::Mat& img);
+
+	bool empty() const;
+
+	int getWidth() const;
+
+	int getHeight() const;
+
+	int getChannels() const;
+
+	ColorSpace getColorSpace() const;
+
+	// rows x cols CV_32F view of channel c
+	const cv::Mat& getPlane(int c) const;
+
+	const float* getRow(int c, int y) const;
+
+	// One CV_32FC3 row per pixel in raster order, the layout cv::kmeans expects
+	const cv::Mat& getSamples() const;
+
+	// Per-channel mean and population variance of the sampled pixels
+	const cv::Vec3d& getMean() const;
+
+	const cv::Vec3d& getVariance() const;
+
+	// Largest central-difference gradient magnitude over the channels, CV_32F
+	const cv::Mat& getGradient() const;
+
+private:
+
+	ColorSpace					colorSpace;
+	bool						gradient;
+
+	int							width, height;
+
+	int							statisticsStep;
+	cv::Rect					statisticsRoi;
+
+	// Running statistics, merged row by row
+	double						statisticsCount;
+	cv::Vec3d					mean;
+	cv::Vec3d					m2;
+	cv::Vec3d					variance;
+
+	// All planes stacked, row stride rounded up to 16 floats
+	cv::Mat						planeData;
+	std::vector<cv::Mat>		planes;
+
+	cv::Mat						samples;
+	cv::Mat						gradientPlane;
+
+	void						computeGradient();
+
+	void						addStatisticsRow(const uchar* pix, int begin, int end);
+
+};
+
+inline void FeaturePlanes::setColorSpace(ColorSpace _colorSpace) {
+	colorSpace = _colorSpace;
+}
+
+inline void FeaturePlanes::setGradient(bool _gradient) {
+	gradient = _gradient;
+}
+
+inline void FeaturePlanes::setStatisticsStep(int _step) {
+	statisticsStep = std::max(1, _step);
+}
+
+inline void FeaturePlanes::setStatisticsRoi(const cv::Rect& _roi) {
+	statisticsRoi = _roi;
+}
+
+inline const cv::Vec3d& FeaturePlanes::getMean() const {
+	return mean;
+}
+
+inline const cv::Vec3d& FeaturePlanes::getVariance() const {
+	return variance;
+}
+
+inline bool FeaturePlanes::empty() const {
+	return planes.empty();
+}
+
+inline int FeaturePlanes::getWidth() const {
+	return width;
+}
+
+inline int FeaturePlanes::getHeight() const {
+	return height;
+}
+
+inline int FeaturePlanes::getChannels() const {
+	return (int)planes.size();
+}
+
+inline FeaturePlanes::ColorSpace FeaturePlanes::getColorSpace() const {
+	return colorSpace;
+}
+
+inline const cv::Mat& FeaturePlanes::getPlane(int c) const {
+	return planes[c];
+}
+
+inline const float* FeaturePlanes::getRow(int c, int y) const {
+	return planes[c].ptr<float>(y);
+}
+
+inline const cv::Mat& FeaturePlanes::getSamples() const {
+	return samples;
+}
+
+inline const cv::Mat& FeaturePlanes::getGradient() const {
+	return gradientPlane;
+}
+
+#endif /* FEATURE_PLANES_H_ */
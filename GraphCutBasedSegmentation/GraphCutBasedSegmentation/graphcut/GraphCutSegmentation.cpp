@@ -4,38 +4,53 @@
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
+#include <algorithm>
+#include <numeric>
 
-void GraphCutSegmentation::calcColorVariance(const cv::Mat & origImg) {
-	cv::Scalar tmp = cv::mean(origImg);
-	cv::Vec3f avgColor{ (float)tmp[0], (float)tmp[1], (float)tmp[2] };
-	sigmaSqr = { 0.0f, 0.0f, 0.0f };
-	for (int r = 0; r < origImg.rows; r++)
-		for (int c = 0; c < origImg.cols; c++) {
-			cv::Vec3f tmpPix = origImg.at<cv::Vec3b>(r, c);
-			auto diff = tmpPix - avgColor;
-			sigmaSqr += cv::Vec3f{diff[0] * diff[0], \
-				diff[1] * diff[1], \
-				diff[2] * diff[2]};
+void GraphCutSegmentation::calcColorVariance(const FeaturePlanes& planes) {
+	// Gathered while the planes were converted
+	const cv::Vec3d& variance = planes.getVariance();
+	sigmaSqr = { (float)variance[0], (float)variance[1], (float)variance[2] };
+}
+
+void GraphCutSegmentation::initNWeightTable() {
+
+	const int size = 2 * MAX_COLOR_DIFF + 1;
+	nWeightTable.resize(dim * size);
+
+	for (int i = 0; i < dim; i++) {
+		float* table = &nWeightTable[i * size + MAX_COLOR_DIFF];
+		for (int d = -MAX_COLOR_DIFF; d <= MAX_COLOR_DIFF; d++) {
+			// A flat channel only tells equal colours apart from different ones
+			if (sigmaSqr[i] > 0)
+				table[d] = std::exp(-(d * d) / (2 * sigmaSqr[i]));
+			else
+				table[d] = (d == 0 ? 1.0f : 0.0f);
 		}
-	int numPix = origImg.rows * origImg.cols;
-	sigmaSqr /= numPix;
+	}
 
 }
 
-void GraphCutSegmentation::initComponent(const cv::Mat& origImg, const cv::Mat& seedMask) {
+void GraphCutSegmentation::initComponent(const FeaturePlanes& planes, const cv::Mat& seedMask) {
 
-	calcColorVariance(origImg);
-	cv::Mat data_points;
-	origImg.convertTo(data_points, CV_32FC3);
-	data_points = data_points.reshape(0, origImg.rows * origImg.cols);
+	calcColorVariance(planes);
+	initNWeightTable();
+	const cv::Mat& data_points = planes.getSamples();
 
-	cv::kmeans(data_points,
-		nCluster,
-		cluster_idx,
-		cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 50, 1.0),
-		1,
-		cv::KMEANS_RANDOM_CENTERS
-	);
+	if (sampleStep <= 1) {
+		colorModel.fit(data_points, cluster_idx);
+	}
+	else {
+		int numPix = data_points.rows;
+		cv::Mat sample((numPix + sampleStep - 1) / sampleStep, 1, CV_32FC3);
+		for (int i = 0; i < sample.rows; i++)
+			sample.at<cv::Vec3f>(i, 0) = data_points.at<cv::Vec3f>(i * sampleStep, 0);
+
+		// Every pixel still needs a cluster, seeded ones feed the histograms
+		cv::Mat sample_idx;
+		colorModel.fit(sample, sample_idx);
+		colorModel.predict(data_points, cluster_idx);
+	}
 
 	std::vector<int> obj_hist(nCluster + 1), bkg_hist(nCluster + 1);
 	bkgRelativeHistogram.resize(nCluster);
@@ -76,65 +91,258 @@ void GraphCutSegmentation::initComponent(const cv::Mat& origImg, const cv::Mat&
 
 }
 
-void GraphCutSegmentation::buildGraph(const cv::Mat& origImg, const cv::Mat& seedMask) {
+int GraphCutSegmentation::prelabel(const FeaturePlanes& planes, const cv::Mat& seedMask, cv::Mat& labelMask) {
 
-	g->add_node(imgWidth * imgHeight);
+	labelMask = seedMask.clone();
 
+	int numPix = imgWidth * imgHeight;
 	cv::Rect imgRect(cv::Point(), cv::Size(imgWidth, imgHeight));
-	K = 0.0f;
-	std::vector<bool> isAdded(imgWidth * imgHeight, false);
 
-	for (int i = 0; i < imgHeight; i++) {
+	// t-links including the n-links to fixed neighbours, and n-links to free ones
+	std::vector<float> toSource(numPix, 0.0f), toSink(numPix, 0.0f), freeSum(numPix, 0.0f);
+	std::vector<int> queue;
+	std::vector<bool> queued(numPix, false);
 
+	for (int i = 0; i < imgHeight; i++) {
 		for (int j = 0; j < imgWidth; j++) {
 
-			int node = i * imgWidth + j;
 			cv::Point pix(j, i);
+			if (labelMask.at<char>(pix) != UNKNOWN)
+				continue;
 
-			auto tmpSumNLink = 0.0f;
+			int index = convertPixelToIndex(pix);
+			toSource[index] = calcTWeight(pix, UNKNOWN);
+			toSink[index] = calcTWeight(pix, UNKNOWN, false);
 
-			// Relation to neighbors
 			for (auto &k : neighbor8) {
-
 				cv::Point neighborPix = pix + k;
+				if (!imgRect.contains(neighborPix))
+					continue;
+
+				float w = calcNWeight(pix, neighborPix, planes);
+				switch (labelMask.at<char>(neighborPix)) {
+				case OBJECT:
+					toSource[index] += w;
+					break;
+				case BACKGROUND:
+					toSink[index] += w;
+					break;
+				default:
+					freeSum[index] += w;
+					break;
+				}
+			}
+
+			queue.push_back(index);
+			queued[index] = true;
+		}
+	}
+
+	int labelled = 0;
+	while (!queue.empty()) {
+
+		int index = queue.back();
+		queue.pop_back();
+		queued[index] = false;
+
+		cv::Point pix(index % imgWidth, index / imgWidth);
+		char& label = labelMask.at<char>(pix);
+		if (label != UNKNOWN)
+			continue;
+
+		// Cutting every free n-link costs less than the t-link margin
+		float margin = toSource[index] - toSink[index];
+		if (margin > freeSum[index])
+			label = OBJECT;
+		else if (-margin > freeSum[index])
+			label = BACKGROUND;
+		else
+			continue;
+		labelled++;
+
+		for (auto &k : neighbor8) {
+			cv::Point neighborPix = pix + k;
+			if (!imgRect.contains(neighborPix) || labelMask.at<char>(neighborPix) != UNKNOWN)
+				continue;
+
+			int neighbor = convertPixelToIndex(neighborPix);
+			float w = calcNWeight(neighborPix, pix, planes);
+			freeSum[neighbor] -= w;
+			if (label == OBJECT)
+				toSource[neighbor] += w;
+			else
+				toSink[neighbor] += w;
+
+			if (!queued[neighbor]) {
+				queue.push_back(neighbor);
+				queued[neighbor] = true;
+			}
+		}
+	}
+
+	return labelled;
+
+}
+
+namespace {
+
+	// Bits of x and y interleaved, x in the even bits
+	uint64_t mortonCode(int x, int y) {
+		uint64_t code = 0;
+		for (int bit = 0; bit < 32; bit++) {
+			code |= uint64_t((x >> bit) & 1) << (2 * bit);
+			code |= uint64_t((y >> bit) & 1) << (2 * bit + 1);
+		}
+		return code;
+	}
+
+}
+
+void GraphCutSegmentation::initNodes(const cv::Mat& seedMask) {
+
+	fixedMask = seedMask.clone();
+	nodeIndex.assign(imgWidth * imgHeight, -1);
+	nodePixel.clear();
+
+	auto addNode = [&](int i, int j) {
+		if (seedMask.at<char>(i, j) == UNKNOWN) {
+			nodeIndex[i * imgWidth + j] = (int)nodePixel.size();
+			nodePixel.push_back(i * imgWidth + j);
+		}
+	};
+
+	switch (nodeOrder) {
+
+	case TILED_ORDER:
+		for (int ti = 0; ti < imgHeight; ti += NODE_TILE_SIZE)
+			for (int tj = 0; tj < imgWidth; tj += NODE_TILE_SIZE)
+				for (int i = ti; i < std::min(ti + NODE_TILE_SIZE, imgHeight); i++)
+					for (int j = tj; j < std::min(tj + NODE_TILE_SIZE, imgWidth); j++)
+						addNode(i, j);
+		break;
+
+	case MORTON_ORDER: {
+		std::vector<std::pair<uint64_t, int>> order;
+		order.reserve(imgWidth * imgHeight);
+		for (int i = 0; i < imgHeight; i++)
+			for (int j = 0; j < imgWidth; j++)
+				order.emplace_back(mortonCode(j, i), i * imgWidth + j);
+		std::sort(order.begin(), order.end());
+		for (auto& entry : order)
+			addNode(entry.second / imgWidth, entry.second % imgWidth);
+		break;
+	}
+
+	default:
+		for (int i = 0; i < imgHeight; i++)
+			for (int j = 0; j < imgWidth; j++)
+				addNode(i, j);
+		break;
+
+	}
+
+}
+
+int GraphCutSegmentation::countEdges() {
+
+	cv::Rect imgRect(cv::Point(), cv::Size(imgWidth, imgHeight));
+	int numEdges = 0;
+
+	for (int node = 0; node < getNumNodes(); node++) {
+		cv::Point pix = convertNodeToPixel(node);
+		for (auto &k : neighbor8) {
+			cv::Point neighborPix = pix + k;
+			if (imgRect.contains(neighborPix) && convertPixelToNode(neighborPix) > node)
+				numEdges++;
+		}
+	}
+
+	return numEdges;
+
+}
+
+void GraphCutSegmentation::createGraph() {
+
+	int numNodes = getNumNodes();
+	graphEdges = countEdges();
+
+	if (solver == MaxflowSolver::AUTO) {
+		SolverSelector* history = (selector != NULL ? selector : &ownSelector);
+		graphSolver = history->choose(numNodes, graphEdges, solverChoice);
+	}
+	else {
+		graphSolver = solver;
+		solverChoice = std::string(MaxflowSolver::algorithmName(solver)) + ": set by setSolver()";
+	}
+
+	g.reset(MaxflowSolver::create(graphSolver, std::max(numNodes, 1), std::max(graphEdges, 1)));
+
+	// Trees can only be reused from a cut of this graph
+	runFirstTime = true;
+
+}
+
+void GraphCutSegmentation::buildGraph(const FeaturePlanes& planes, const cv::Mat& seedMask) {
+
+	int numNodes = getNumNodes();
+	// Pre-labelling may decide every pixel, the graph then stays empty
+	if (numNodes > 0)
+		g->add_node(numNodes);
 
-				if (imgRect.contains(neighborPix)) {
+	cv::Rect imgRect(cv::Point(), cv::Size(imgWidth, imgHeight));
+	K = 0.0f;
 
-					int neighborNode = convertPixelToNode(neighborPix);
-					auto tmpNWeight = calcNWeight(pix, neighborPix, origImg);
-					tmpSumNLink += 2 * tmpNWeight;
+	// A seeded pixel never changes side, so its n-link to a node is a t-link of that node
+	std::vector<float> fixedToSource(numNodes, 0.0f), fixedToSink(numNodes, 0.0f);
 
-					if (!isAdded[neighborNode]) {
-						g->add_edge(node, neighborNode,
-							tmpNWeight,
-							tmpNWeight);
-					}
+	for (int node = 0; node < numNodes; node++) {
 
+		cv::Point pix = convertNodeToPixel(node);
 
+		auto tmpSumNLink = 0.0f;
+
+		// Relation to neighbors
+		for (auto &k : neighbor8) {
+
+			cv::Point neighborPix = pix + k;
+
+			if (imgRect.contains(neighborPix)) {
+
+				int neighborNode = convertPixelToNode(neighborPix);
+				auto tmpNWeight = calcNWeight(pix, neighborPix, planes);
+				tmpSumNLink += 2 * tmpNWeight;
+
+				// Whichever node comes first adds the edge
+				if (neighborNode > node) {
+					g->add_edge(node, neighborNode,
+						tmpNWeight,
+						tmpNWeight);
 				}
+				else if (neighborNode < 0) {
+					if (seedMask.at<char>(neighborPix) == OBJECT)
+						fixedToSource[node] += tmpNWeight;
+					else
+						fixedToSink[node] += tmpNWeight;
+				}
+
 			}
-			isAdded[node] = true;
-			K = std::max(tmpSumNLink, K);
 		}
+		K = std::max(tmpSumNLink, K);
 	}
 
 	K += 1.0f;
 
-	for (int i = 0; i < imgHeight; i++) {
+	for (int node = 0; node < numNodes; node++) {
 
-		for (int j = 0; j < imgWidth; j++) {
+		cv::Point pix = convertNodeToPixel(node);
 
-			int node = i * imgWidth + j;
-			cv::Point pix(j, i);
-
-			// Relation to source and sink
-			g->add_tweights(
-				node,
-				calcTWeight(pix, seedMask.at<char>(pix)),
-				calcTWeight(pix, seedMask.at<char>(pix), false)
-			);
+		// Relation to source and sink
+		g->add_tweights(
+			node,
+			calcTWeight(pix, UNKNOWN) + fixedToSource[node],
+			calcTWeight(pix, UNKNOWN, false) + fixedToSink[node]
+		);
 
-		}
 	}
 
 }
@@ -163,85 +371,315 @@ float GraphCutSegmentation::calcTWeight(const cv::Point& pix, int pixType, bool
 
 }
 
-float GraphCutSegmentation::calcNWeight(const cv::Point& pix1, const cv::Point& pix2, const cv::Mat& origImg)
+float GraphCutSegmentation::calcNWeight(const cv::Point& pix1, const cv::Point& pix2, const FeaturePlanes& planes)
 {
-	auto r1 = origImg.at<cv::Vec3b>(pix1), \
-		r2 = origImg.at<cv::Vec3b>(pix2);
-	float intensityDiff = 0.0f;
+	// Planes hold 8-bit values, so every channel difference is a table entry
+	const int size = 2 * MAX_COLOR_DIFF + 1;
+	float weight = 1.0f;
 	for (int i = 0; i < dim; i++) {
-		float tmpDiff = r1[i] * 1.0f - r2[i];
-		intensityDiff += (tmpDiff * tmpDiff / (2 * sigmaSqr[i]));
+		int tmpDiff = (int)(planes.getRow(i, pix1.y)[pix1.x] - planes.getRow(i, pix2.y)[pix2.x]);
+		weight *= nWeightTable[i * size + MAX_COLOR_DIFF + tmpDiff];
 	}
-	auto dist = pix2 - pix1;
-	return  exp(-intensityDiff)
-		/ std::sqrt(dist.x * dist.x + dist.y * dist.y);
+
+	// Neighbours are one step away, diagonal ones sqrt(2)
+	static const float DIAGONAL_FACTOR = 0.70710678f;
+	return (pix1.x != pix2.x && pix1.y != pix2.y) ? weight * DIAGONAL_FACTOR : weight;
 }
 
 float GraphCutSegmentation::Pr_bkg(const cv::Point& pix) {
 
-	return -log(bkgRelativeHistogram[cluster_idx.at<int>(convertPixelToNode(pix), 0)]);
+	return -log(bkgRelativeHistogram[cluster_idx.at<int>(convertPixelToIndex(pix), 0)]);
 
 }
 
 float GraphCutSegmentation::Pr_obj(const cv::Point& pix) {
 
-	return -log(objRelativeHistogram[cluster_idx.at<int>(convertPixelToNode(pix), 0)]);
+	return -log(objRelativeHistogram[cluster_idx.at<int>(convertPixelToIndex(pix), 0)]);
 }
 
 void GraphCutSegmentation::cutGraph(cv::Mat& outputMask) {
 
 	outputMask.create(cv::Size(imgWidth, imgHeight), CV_8U);
 	float flow = 0.0;
-	flow = g->maxflow(!runFirstTime, NULL);
-	runFirstTime = false;
+	if (getNumNodes() > 0) {
+		g->set_interrupt(cutCancel, cutBudget);
+		flow = g->maxflow(!runFirstTime);
+		cutOptimal = g->is_optimal();
+		runFirstTime = false;
+	}
+	else {
+		// Every pixel is in fixedMask, there is nothing to cut
+		cutOptimal = true;
+	}
 
-	int node = 0;
+	int pixel = 0;
 
-	int numBkg = 0, numObj = 0;
 	for (int i = 0; i < imgHeight; i++) {
-		for (int j = 0; j < imgWidth; j++) {
+		uchar* out = outputMask.ptr<uchar>(i);
+		for (int j = 0; j < imgWidth; j++, pixel++) {
+
+			int node = nodeIndex[pixel];
+			if (node < 0)
+				out[j] = (fixedMask.at<char>(i, j) == OBJECT ? 255 : 0);
+			else if (cutOptimal || g->what_segment(node, GraphType::SOURCE) == g->what_segment(node, GraphType::SINK))
+				out[j] = (g->what_segment(node) == GraphType::SOURCE ? 255 : 0);
+			else
+				out[j] = (Pr_bkg(cv::Point(j, i)) >= Pr_obj(cv::Point(j, i)) ? 255 : 0);
+		}
+	}
 
-			if (g->what_segment(node) == GraphType::SOURCE) {
-				outputMask.at<uchar>(i, j) = 255;
-				numObj++;
-			}
-			else if (g->what_segment(node) == GraphType::SINK) {
-				outputMask.at<uchar>(i, j) = 0;
-				numBkg++;
+}
+
+cv::Rect GraphCutSegmentation::computeSolveRect(const cv::Mat& seedMask) {
+
+	cv::Rect imgRect(cv::Point(), seedMask.size());
+
+	if (roi.area() > 0) {
+		cv::Rect rect = roi & imgRect;
+		return rect.area() > 0 ? rect : imgRect;
+	}
+
+	if (roiMargin < 0)
+		return imgRect;
+
+	int minX = seedMask.cols, minY = seedMask.rows, maxX = -1, maxY = -1;
+	for (int i = 0; i < seedMask.rows; i++) {
+		const char* seed = seedMask.ptr<char>(i);
+		for (int j = 0; j < seedMask.cols; j++) {
+			if (seed[j] == OBJECT) {
+				minX = std::min(minX, j);
+				maxX = std::max(maxX, j);
+				minY = std::min(minY, i);
+				maxY = std::max(maxY, i);
 			}
-			node++;
 		}
 	}
 
+	// No object seed to go by
+	if (maxX < 0)
+		return imgRect;
+
+	cv::Rect rect(minX - roiMargin, minY - roiMargin,
+		maxX - minX + 1 + 2 * roiMargin, maxY - minY + 1 + 2 * roiMargin);
+	return rect & imgRect;
+
+}
+
+void GraphCutSegmentation::pasteSolveRect(const cv::Mat& rectMask, cv::Mat& outputMask) {
+
+	if (solveRect.size() == imageSize) {
+		outputMask = rectMask;
+		return;
+	}
+
+	outputMask = cv::Mat::zeros(imageSize, CV_8U);
+	cv::Mat dst = outputMask(solveRect);
+	rectMask.copyTo(dst);
+
 }
 
 void GraphCutSegmentation::segment(const cv::Mat& img, const cv::Mat& seedMask, cv::Mat& outputMask) {
 
-	g.reset(new GraphType(getNumNodes(img), getNumEdges(img)));
-	imgWidth = img.cols;
-	imgHeight = img.rows;
+	imageSize = img.size();
+	solveRect = computeSolveRect(seedMask);
+
+	if (solveRect.size() == imageSize) {
+		int64 start = cv::getTickCount();
+		features.compute(img);
+		double featureTime = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+		segment(features, seedMask, outputMask);
+		stageTimes["features"] = featureTime;
+		return;
+	}
+
+	// Colour statistics, clustering and the graph all see the roi only
+	int64 start = cv::getTickCount();
+	features.compute(img(solveRect));
+	double featureTime = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	// The outside is background, pin the roi border where it faces the outside
+	cv::Mat rectSeeds = seedMask(solveRect).clone();
+	int last = rectSeeds.rows - 1;
+	for (int j = 0; j < rectSeeds.cols; j++) {
+		if (solveRect.y > 0 && rectSeeds.at<char>(0, j) != OBJECT)
+			rectSeeds.at<char>(0, j) = BACKGROUND;
+		if (solveRect.br().y < imageSize.height && rectSeeds.at<char>(last, j) != OBJECT)
+			rectSeeds.at<char>(last, j) = BACKGROUND;
+	}
+	last = rectSeeds.cols - 1;
+	for (int i = 0; i < rectSeeds.rows; i++) {
+		if (solveRect.x > 0 && rectSeeds.at<char>(i, 0) != OBJECT)
+			rectSeeds.at<char>(i, 0) = BACKGROUND;
+		if (solveRect.br().x < imageSize.width && rectSeeds.at<char>(i, last) != OBJECT)
+			rectSeeds.at<char>(i, last) = BACKGROUND;
+	}
+
+	// The planes overload takes the roi for the whole image, put it back
+	cv::Rect rect = solveRect;
+	cv::Mat rectMask;
+	segment(features, rectSeeds, rectMask);
+	stageTimes["features"] = featureTime;
+
+	solveRect = rect;
+	imageSize = img.size();
+	pasteSolveRect(rectMask, outputMask);
+
+}
+
+void GraphCutSegmentation::segment(const FeaturePlanes& planes, const cv::Mat& seedMask, cv::Mat& outputMask) {
+
+	stageTimes.clear();
 
-	initComponent(img, seedMask);
+	imgWidth = planes.getWidth();
+	imgHeight = planes.getHeight();
+	imageSize = cv::Size(imgWidth, imgHeight);
+	solveRect = cv::Rect(cv::Point(), imageSize);
 
-	buildGraph(img, seedMask);
+	int64 start = cv::getTickCount();
+	initComponent(planes, seedMask);
+	stageTimes["component"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
 
+	cv::Mat labelMask = seedMask;
+	if (persistency) {
+		start = cv::getTickCount();
+		prelabel(planes, seedMask, labelMask);
+		stageTimes["prelabel"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+	}
+
+	initNodes(labelMask);
+	createGraph();
+
+	start = cv::getTickCount();
+	buildGraph(planes, labelMask);
+	stageTimes["graph"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	start = cv::getTickCount();
 	cutGraph(outputMask);
+	stageTimes["maxflow"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	// An interrupted cut says nothing about how long the whole one takes
+	if (cutOptimal) {
+		SolverSelector* history = (selector != NULL ? selector : &ownSelector);
+		history->addSample(graphSolver, getNumNodes(), graphEdges, stageTimes["maxflow"]);
+	}
+
+}
+
+bool GraphCutSegmentation::segmentAnytime(const cv::Mat& img, const cv::Mat& seedMask, cv::Mat& outputMask,
+	double budget, const std::atomic<bool>* cancel) {
+
+	cutBudget = budget;
+	cutCancel = cancel;
+	segment(img, seedMask, outputMask);
+	cutBudget = 0;
+	cutCancel = NULL;
+
+	return cutOptimal;
+
+}
+
+bool GraphCutSegmentation::resume(cv::Mat& outputMask, double budget, const std::atomic<bool>* cancel) {
+
+	cutBudget = budget;
+	cutCancel = cancel;
+
+	// BK grows its search trees again instead of reusing them; the flow
+	// pushed so far stays in the residual graph either way
+	if (graphSolver == MaxflowSolver::BK)
+		runFirstTime = true;
+
+	cv::Mat rectMask;
+	cutGraph(rectMask);
+	pasteSolveRect(rectMask, outputMask);
+	cutBudget = 0;
+	cutCancel = NULL;
+
+	return cutOptimal;
+
+}
+
+void GraphCutSegmentation::segmentLambdas(const FeaturePlanes& planes, const cv::Mat& seedMask,
+	const std::vector<float>& lambdas, std::vector<cv::Mat>& outputMasks) {
+
+	stageTimes.clear();
+	outputMasks.assign(lambdas.size(), cv::Mat());
+	imageSize = cv::Size(planes.getWidth(), planes.getHeight());
+	solveRect = cv::Rect(cv::Point(), imageSize);
+	if (lambdas.empty())
+		return;
+
+	// Only growing t-links can be added on top of the flow already pushed
+	std::vector<size_t> order(lambdas.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(),
+		[&lambdas](size_t a, size_t b) { return lambdas[a] < lambdas[b]; });
+
+	imgWidth = planes.getWidth();
+	imgHeight = planes.getHeight();
+	setRegionBoundaryRelation(lambdas[order[0]]);
+
+	// Pre-labelling holds for one lambda only, the sweep keeps every pixel a node
+	initNodes(seedMask);
+	createGraph();
+
+	int64 start = cv::getTickCount();
+	initComponent(planes, seedMask);
+	stageTimes["component"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	start = cv::getTickCount();
+	buildGraph(planes, seedMask);
+	stageTimes["graph"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	start = cv::getTickCount();
+	cutGraph(outputMasks[order[0]]);
+
+	int numNodes = getNumNodes();
+	for (size_t k = 1; k < order.size(); k++) {
+
+		float delta = lambdas[order[k]] - lambda;
+		setRegionBoundaryRelation(lambdas[order[k]]);
+
+		if (delta > 0) {
+			for (int node = 0; node < numNodes; node++) {
+				cv::Point pix = convertNodeToPixel(node);
+				g->mark_node(node);
+				g->add_tweights(node, delta * Pr_bkg(pix), delta * Pr_obj(pix));
+			}
+		}
+
+		cutGraph(outputMasks[order[k]]);
+	}
+	stageTimes["maxflow"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
 
 }
 
 void GraphCutSegmentation::updateSeeds(const std::vector<cv::Point>& newSeeds, PixelType pixType, cv::Mat& outputMask) {
-	for (const auto& p : newSeeds) {
-		g->mark_node(convertPixelToNode(p));
+	for (const auto& seed : newSeeds) {
+		// Outside the roi stays background
+		if (!solveRect.contains(seed))
+			continue;
+		cv::Point p = seed - solveRect.tl();
+
+		// Pixels seeded at segment() time have no node and keep their side
+		int node = convertPixelToNode(p);
+		if (node < 0)
+			continue;
+		g->mark_node(node);
 		g->add_tweights(
-			convertPixelToNode(p),
+			node,
 			calcTWeight(p, pixType),
 			calcTWeight(p, pixType, false)
 		);
 	}
-	cutGraph(outputMask);
+
+	cv::Mat rectMask;
+	cutGraph(rectMask);
+	pasteSolveRect(rectMask, outputMask);
 }
 
 GraphCutSegmentation::GraphCutSegmentation() {
+	setSolverSelector(NULL);
 	initParam();
 }
 
@@ -1,12 +1,18 @@
 #ifndef GRAPHCUT_SEGMENTATION_H_
 #define GRAPHCUT_SEGMENTATION_H_
 
+#include <atomic>
+#include <map>
 #include <memory>
+#include <string>
 #include <opencv2\opencv.hpp>
-#include "..\max_flow\graph.h"
+#include "..\max_flow\MaxflowSolver.h"
+#include "SolverSelector.h"
+#include "..\common\ColorModel.h"
+#include "..\common\FeaturePlanes.h"
 
 class GraphCutSegmentation {
-	typedef Graph<double, double, double> GraphType;
+	typedef MaxflowSolver GraphType;
 
 public:
 
@@ -16,6 +22,13 @@ public:
 		OBJECT = 1
 	};
 
+	// Numbering of the graph nodes, keeps 2D neighbours close in memory
+	enum NodeOrder {
+		RASTER_ORDER,
+		TILED_ORDER,
+		MORTON_ORDER
+	};
+
 	GraphCutSegmentation();
 
 	~GraphCutSegmentation();
@@ -24,23 +37,87 @@ public:
 
 	void setNDimension(int);
 
-	void calcColorVariance(const cv::Mat& origImg);
+	// Seed of the colour clustering, equal seeds give equal masks
+	void setSeed(uint64_t);
+
+	// Cluster every step-th pixel only, the rest take the nearest centre
+	void setClusterSampleStep(int);
+
+	// Colour variance from every step-th row and column only
+	void setVarianceSampleStep(int);
+
+	void calcColorVariance(const FeaturePlanes& planes);
 
 	void setRegionBoundaryRelation(float);
 
-	void initComponent(const cv::Mat& origImg, const cv::Mat& seedMask);
+	// Label pixels whose t-link margin outweighs their n-links before the
+	// cut. They are then fixed like seeds and updateSeeds() cannot flip
+	// them, so it is off by default and meant for one-shot cuts.
+	void setPersistency(bool);
+
+	// Solve inside roi only, everything outside is background. An empty
+	// rect turns it off.
+	void setRoi(const cv::Rect&);
+
+	// Without an explicit roi, solve inside the object seed extent grown by
+	// margin pixels. Negative turns it off.
+	void setRoiMargin(int);
+
+	void setNodeOrder(NodeOrder);
+
+	// Max-flow backend of the next segment(). AUTO, the default, lets the
+	// selector choose from the graph size and the timing of earlier cuts.
+	void setSolver(MaxflowSolver::Algorithm);
 
-	void buildGraph(const cv::Mat& origImg, const cv::Mat& seedMask);
+	// Timing history shared with other objects, must outlive this one.
+	// NULL keeps a history of this object only.
+	void setSolverSelector(SolverSelector*);
+
+	void initComponent(const FeaturePlanes& planes, const cv::Mat& seedMask);
+
+	// seedMask plus every pixel whose label is already decided, repeated as
+	// decided pixels fix their neighbours' n-links. Returns the pixels added.
+	int prelabel(const FeaturePlanes& planes, const cv::Mat& seedMask, cv::Mat& labelMask);
+
+	// Graph nodes are the UNKNOWN pixels only, seeded pixels are folded into t-links
+	void initNodes(const cv::Mat& seedMask);
+
+	void buildGraph(const FeaturePlanes& planes, const cv::Mat& seedMask);
 
 	void cutGraph(cv::Mat& outMask);
 
 	void segment(const cv::Mat& img, const cv::Mat& seedMask, cv::Mat& outputMask);
 
+	// Planes computed once by the caller, e.g. when the same image is cut repeatedly
+	void segment(const FeaturePlanes& planes, const cv::Mat& seedMask, cv::Mat& outputMask);
+
+	// One mask per lambda from a single graph: lambdas are cut in ascending
+	// order, raising the t-links and reusing the flow of the previous cut.
+	// The graph is left at the largest lambda.
+	void segmentLambdas(const FeaturePlanes& planes, const cv::Mat& seedMask,
+		const std::vector<float>& lambdas, std::vector<cv::Mat>& outputMasks);
+
+	// segment() whose max-flow stops budget seconds in (<= 0 for no limit) or
+	// once *cancel is set from another thread. Returns whether outputMask is
+	// the optimal cut; if not it is a preview: pixels in the search trees of
+	// the cut so far keep their tree's side, the rest follow their stronger
+	// t-link. resume() carries on with the same graph and the flow found so far.
+	bool segmentAnytime(const cv::Mat& img, const cv::Mat& seedMask, cv::Mat& outputMask,
+		double budget, const std::atomic<bool>* cancel = NULL);
+
+	bool resume(cv::Mat& outputMask, double budget, const std::atomic<bool>* cancel = NULL);
+
 	void updateSeeds(const std::vector<cv::Point>& newSeeds, PixelType pixType, cv::Mat& outputMask);
 
 	void createDefault();
 	void cleanGarbage();
 
+	// Seconds spent in each stage of the last segment() call
+	const std::map<std::string, double>& getStageTimes() const;
+
+	// Backend of the last graph and why it was chosen
+	const std::string& getSolverChoice() const;
+
 private:
 
 	const std::vector<cv::Point> neighbor8{
@@ -51,6 +128,17 @@ private:
 	};
 
 	std::unique_ptr<GraphType>	g;
+	MaxflowSolver::Algorithm	solver;
+	MaxflowSolver::Algorithm	graphSolver;
+	std::string					solverChoice;
+	SolverSelector*				selector;
+	SolverSelector				ownSelector;
+	int							graphEdges;
+
+	// Limits of the next cut, see segmentAnytime()
+	double						cutBudget;
+	const std::atomic<bool>*	cutCancel;
+	bool						cutOptimal;
 
 	int							imgWidth, imgHeight;
 
@@ -58,20 +146,60 @@ private:
 
 	int							nCluster;
 	int							dim;
+	int							sampleStep;
 	cv::Vec3f					sigmaSqr;
+
+	// exp(-d^2 / (2 sigma^2)) per channel for every 8-bit difference d
+	static const int			MAX_COLOR_DIFF = 255;
+	std::vector<float>			nWeightTable;
 	float						lambda;
+	bool						persistency;
+
+	cv::Rect					roi;
+	int							roiMargin;
+
+	// Part of the image the graph of the last segment() covers
+	cv::Rect					solveRect;
+	cv::Size					imageSize;
 	bool						runFirstTime;
 
 	cv::Mat						cluster_idx;
+	ColorModel					colorModel;
+
+	// Pixel index to graph node, -1 for seeded pixels, and back
+	NodeOrder					nodeOrder;
+	static const int			NODE_TILE_SIZE = 16;
+	std::vector<int>			nodeIndex;
+	std::vector<int>			nodePixel;
+	cv::Mat						fixedMask;
 
 	std::vector<float>			bkgRelativeHistogram;
 	std::vector<float>			objRelativeHistogram;
 
+	std::map<std::string, double>	stageTimes;
+
+	FeaturePlanes				features;
+
 	void						initParam();
 
 	float						calcTWeight(const cv::Point& pix, int pixType, bool toSource = true);
 
-	float						calcNWeight(const cv::Point& pix1, const cv::Point& pix2, const cv::Mat& origImg); //B_pq
+	void						initNWeightTable();
+
+	// n-links between the current nodes
+	int							countEdges();
+
+	// Empty graph for the current nodes on the chosen backend, cut from scratch next
+	void						createGraph();
+
+	cv::Rect					computeSolveRect(const cv::Mat& seedMask);
+
+	// Full image mask from the mask of solveRect
+	void						pasteSolveRect(const cv::Mat& rectMask, cv::Mat& outputMask);
+
+	float						calcNWeight(const cv::Point& pix1, const cv::Point& pix2, const FeaturePlanes& planes); //B_pq
+
+	int							convertPixelToIndex(const cv::Point&);
 
 	int							convertPixelToNode(const cv::Point&);
 
@@ -81,33 +209,45 @@ private:
 
 	float						Pr_obj(const cv::Point&);
 
-	int							getNumNodes(const cv::Mat& img);
+	int							getNumNodes();
 
-	int							getNumEdges(const cv::Mat& img);
+	int							getNumEdges();
 
 };
 
-inline int GraphCutSegmentation::getNumEdges(const cv::Mat& img) {
-	return img.cols * img.rows * 10;
+inline int GraphCutSegmentation::getNumEdges() {
+	return getNumNodes() * 10;
 }
 
-inline int GraphCutSegmentation::getNumNodes(const cv::Mat& img) {
-	return img.cols * img.rows;
+inline int GraphCutSegmentation::getNumNodes() {
+	return (int)nodePixel.size();
 }
 
-inline int GraphCutSegmentation::convertPixelToNode(const cv::Point& pix)
+inline int GraphCutSegmentation::convertPixelToIndex(const cv::Point& pix)
 {
 	return pix.y * imgWidth + pix.x;
 }
 
+inline int GraphCutSegmentation::convertPixelToNode(const cv::Point& pix)
+{
+	return nodeIndex[convertPixelToIndex(pix)];
+}
+
 inline cv::Point GraphCutSegmentation::convertNodeToPixel(int node)
 {
-	return cv::Point(node % imgWidth, node / imgWidth);
+	int index = nodePixel[node];
+	return cv::Point(index % imgWidth, index / imgWidth);
 }
 
 inline void GraphCutSegmentation::setNCluster(int _cluster)
 {
 	nCluster = _cluster;
+	colorModel.setClusterNumber(_cluster);
+}
+
+inline void GraphCutSegmentation::setSeed(uint64_t _seed)
+{
+	colorModel.setSeed(_seed);
 }
 
 inline void GraphCutSegmentation::setNDimension(int _dim)
@@ -115,18 +255,75 @@ inline void GraphCutSegmentation::setNDimension(int _dim)
 	dim = _dim;
 }
 
+inline void GraphCutSegmentation::setClusterSampleStep(int _step)
+{
+	sampleStep = std::max(1, _step);
+}
+
+inline void GraphCutSegmentation::setVarianceSampleStep(int _step)
+{
+	features.setStatisticsStep(_step);
+}
+
 inline void GraphCutSegmentation::setRegionBoundaryRelation(float _lambda)
 {
 	lambda = _lambda;
 }
 
+inline void GraphCutSegmentation::setPersistency(bool _persistency)
+{
+	persistency = _persistency;
+}
+
+inline void GraphCutSegmentation::setRoi(const cv::Rect& _roi)
+{
+	roi = _roi;
+}
+
+inline void GraphCutSegmentation::setRoiMargin(int _margin)
+{
+	roiMargin = _margin;
+}
+
+inline void GraphCutSegmentation::setNodeOrder(NodeOrder _order)
+{
+	nodeOrder = _order;
+}
+
+inline void GraphCutSegmentation::setSolver(MaxflowSolver::Algorithm _solver)
+{
+	solver = _solver;
+}
+
+inline void GraphCutSegmentation::setSolverSelector(SolverSelector* _selector)
+{
+	selector = _selector;
+}
+
 inline void GraphCutSegmentation::initParam() {
 	setNCluster(20);
 	setNDimension(3);
+	setClusterSampleStep(1);
 	setRegionBoundaryRelation(.5f);
+	setPersistency(false);
+	setRoi(cv::Rect());
+	setRoiMargin(-1);
+	setNodeOrder(TILED_ORDER);
+	setSolver(MaxflowSolver::AUTO);
+	cutBudget = 0;
+	cutCancel = NULL;
+	cutOptimal = true;
 	runFirstTime = true;
 }
 
+inline const std::map<std::string, double>& GraphCutSegmentation::getStageTimes() const {
+	return stageTimes;
+}
+
+inline const std::string& GraphCutSegmentation::getSolverChoice() const {
+	return solverChoice;
+}
+
 inline void GraphCutSegmentation::createDefault() {
 	initParam();
 }
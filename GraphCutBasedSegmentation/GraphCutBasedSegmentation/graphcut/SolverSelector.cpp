@@ -0,0 +1,146 @@
+#include "SolverSelector.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <opencv2\opencv.hpp>
+
+namespace {
+
+	// Seconds per node and edge until a backend has been timed. On synthetic
+	// 2000x1500 grids IBFS took about 1.6 times as long as BK.
+	const double DEFAULT_UNIT_COST[MaxflowSolver::AUTO] = { 1e-7, 1.6e-7 };
+
+	// Weight of the newest sample in the running average
+	const double SAMPLE_WEIGHT = 0.3;
+
+	// An untimed backend is tried once another one has this many samples in
+	// the size class, and only if it is expected to finish within the budget
+	const int MIN_SAMPLES = 3;
+	const double EXPLORE_BUDGET = 1.0;
+
+	double graphWork(int numNodes, int numEdges) {
+		return double(numNodes) + double(numEdges);
+	}
+
+}
+
+SolverSelector::SolverSelector() {
+	for (int a = 0; a < MaxflowSolver::AUTO; a++) {
+		for (int c = 0; c < NUM_SIZE_CLASSES; c++) {
+			unitCost[a][c] = DEFAULT_UNIT_COST[a];
+			samples[a][c] = 0;
+		}
+	}
+}
+
+int SolverSelector::sizeClass(int numNodes) {
+	if (numNodes < 250000)
+		return 0;
+	if (numNodes < 4000000)
+		return 1;
+	if (numNodes < 25000000)
+		return 2;
+	return 3;
+}
+
+const char* SolverSelector::sizeClassName(int sizeClass) {
+	static const char* names[NUM_SIZE_CLASSES] = { "<0.25M", "0.25-4M", "4-25M", ">25M" };
+	return names[sizeClass];
+}
+
+double SolverSelector::estimate(MaxflowSolver::Algorithm algorithm, int numNodes, int numEdges) const {
+	return unitCost[algorithm][sizeClass(numNodes)] * graphWork(numNodes, numEdges);
+}
+
+void SolverSelector::addSample(MaxflowSolver::Algorithm algorithm, int numNodes, int numEdges, double seconds) {
+
+	double work = graphWork(numNodes, numEdges);
+	if (algorithm < 0 || algorithm >= MaxflowSolver::AUTO || work <= 0 || seconds <= 0)
+		return;
+
+	int c = sizeClass(numNodes);
+	double cost = seconds / work;
+	unitCost[algorithm][c] = (samples[algorithm][c] == 0 ? cost : (1 - SAMPLE_WEIGHT) * unitCost[algorithm][c] + SAMPLE_WEIGHT * cost);
+	samples[algorithm][c]++;
+
+}
+
+MaxflowSolver::Algorithm SolverSelector::choose(int numNodes, int numEdges, std::string& reason) const {
+
+	int c = sizeClass(numNodes);
+	std::ostringstream log;
+
+	// Without trying the other backends now and then the history would only
+	// ever confirm the defaults
+	int mostSamples = 0;
+	for (int a = 0; a < MaxflowSolver::AUTO; a++)
+		mostSamples = std::max(mostSamples, samples[a][c]);
+
+	for (int a = 0; a < MaxflowSolver::AUTO; a++) {
+		MaxflowSolver::Algorithm algorithm = MaxflowSolver::Algorithm(a);
+		if (samples[a][c] == 0 && mostSamples >= MIN_SAMPLES && estimate(algorithm, numNodes, numEdges) <= EXPLORE_BUDGET) {
+			log << MaxflowSolver::algorithmName(algorithm) << ": not timed on " << sizeClassName(c)
+				<< " node graphs yet, trying it on " << numNodes << " nodes, " << numEdges << " edges";
+			reason = log.str();
+			return algorithm;
+		}
+	}
+
+	MaxflowSolver::Algorithm best = MaxflowSolver::BK;
+	for (int a = 1; a < MaxflowSolver::AUTO; a++)
+		if (estimate(MaxflowSolver::Algorithm(a), numNodes, numEdges) < estimate(best, numNodes, numEdges))
+			best = MaxflowSolver::Algorithm(a);
+
+	log << MaxflowSolver::algorithmName(best) << ": " << numNodes << " nodes, " << numEdges << " edges, estimated";
+	for (int a = 0; a < MaxflowSolver::AUTO; a++)
+		log << " " << MaxflowSolver::algorithmName(MaxflowSolver::Algorithm(a)) << " "
+			<< estimate(MaxflowSolver::Algorithm(a), numNodes, numEdges) << "s (" << samples[a][c] << " runs)";
+	log << " on " << sizeClassName(c) << " node graphs";
+	reason = log.str();
+	return best;
+
+}
+
+bool SolverSelector::load(const std::string& fileName) {
+
+	cv::FileStorage fs(fileName, cv::FileStorage::READ);
+	if (!fs.isOpened())
+		return false;
+
+	bool loaded = false;
+	for (int a = 0; a < MaxflowSolver::AUTO; a++) {
+
+		std::string name = MaxflowSolver::algorithmName(MaxflowSolver::Algorithm(a));
+		std::vector<double> cost;
+		std::vector<int> count;
+		fs[name + "_unitCost"] >> cost;
+		fs[name + "_samples"] >> count;
+		if (cost.size() != NUM_SIZE_CLASSES || count.size() != NUM_SIZE_CLASSES)
+			continue;
+
+		for (int c = 0; c < NUM_SIZE_CLASSES; c++) {
+			if (cost[c] > 0 && count[c] > 0) {
+				unitCost[a][c] = cost[c];
+				samples[a][c] = count[c];
+			}
+		}
+		loaded = true;
+	}
+
+	return loaded;
+
+}
+
+void SolverSelector::save(const std::string& fileName) const {
+
+	cv::FileStorage fs(fileName, cv::FileStorage::WRITE);
+	if (!fs.isOpened())
+		return;
+
+	for (int a = 0; a < MaxflowSolver::AUTO; a++) {
+		std::string name = MaxflowSolver::algorithmName(MaxflowSolver::Algorithm(a));
+		fs << name + "_unitCost" << std::vector<double>(unitCost[a], unitCost[a] + NUM_SIZE_CLASSES);
+		fs << name + "_samples" << std::vector<int>(samples[a], samples[a] + NUM_SIZE_CLASSES);
+	}
+
+}
@@ -0,0 +1,45 @@
+#ifndef SOLVER_SELECTOR_H_
+#define SOLVER_SELECTOR_H_
+
+#include <string>
+#include "..\max_flow\MaxflowSolver.h"
+
+// Chooses the max-flow backend of a graph from its size and density, using
+// the seconds per node and edge each backend took on earlier cuts of
+// graphs of the same size class.
+class SolverSelector {
+
+public:
+
+	SolverSelector();
+
+	// reason gets one line explaining the choice, for the log
+	MaxflowSolver::Algorithm choose(int numNodes, int numEdges, std::string& reason) const;
+
+	// Time of a maxflow() of the given backend
+	void addSample(MaxflowSolver::Algorithm, int numNodes, int numEdges, double seconds);
+
+	// Predicted maxflow() seconds of the backend on such a graph
+	double estimate(MaxflowSolver::Algorithm, int numNodes, int numEdges) const;
+
+	// Timing history of earlier processes
+	bool load(const std::string& fileName);
+
+	void save(const std::string& fileName) const;
+
+private:
+
+	// Thumbnails, ~1 MP, ~10 MP and larger: the best backend may differ
+	static const int	NUM_SIZE_CLASSES = 4;
+
+	// seconds per node and edge, running average per backend and size class
+	double				unitCost[MaxflowSolver::AUTO][NUM_SIZE_CLASSES];
+	int					samples[MaxflowSolver::AUTO][NUM_SIZE_CLASSES];
+
+	static int			sizeClass(int numNodes);
+
+	static const char*	sizeClassName(int sizeClass);
+
+};
+
+#endif /* SOLVER_SELECTOR_H_ */
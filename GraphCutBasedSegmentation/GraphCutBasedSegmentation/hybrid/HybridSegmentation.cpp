@@ -0,0 +1,116 @@
+#include "HybridSegmentation.h"
+
+// Fewer clustered pixels than this make the colour model of the fine cut unstable
+const int MIN_CLUSTER_SAMPLES = 20000;
+
+HybridSegmentation::HybridSegmentation() {
+	setBandWidth(1);
+	// The fine cut is never updated with new seeds
+	fine.setPersistency(true);
+}
+
+void HybridSegmentation::selectRegions(std::vector<bool>& inBand) {
+
+	int n = coarse.getRegionNumber();
+	const RegionAdjacency& adjacency = coarse.getAdjacency();
+
+	inBand.assign(n, false);
+	for (int i = 0; i < n; i++)
+		for (auto& edge : adjacency[i])
+			if (coarse.isForegroundRegion(i) != coarse.isForegroundRegion(edge.to)) {
+				inBand[i] = true;
+				break;
+			}
+
+	for (int ring = 1; ring < bandWidth; ring++) {
+		std::vector<bool> grown = inBand;
+		for (int i = 0; i < n; i++)
+			if (inBand[i])
+				for (auto& edge : adjacency[i])
+					grown[edge.to] = true;
+		inBand.swap(grown);
+	}
+
+}
+
+int HybridSegmentation::buildSeedMask(const std::vector<bool>& inBand, const std::vector<cv::Point>& hintBkg,
+	const std::vector<cv::Point>& hintObj, cv::Mat& seedMask) {
+
+	const cv::Mat& markers = coarse.getMarkers();
+	seedMask.create(markers.size(), CV_8S);
+	band = cv::Mat::zeros(markers.size(), CV_8U);
+
+	int bandPixels = 0;
+	for (int r = 0; r < markers.rows; r++) {
+		const int* label = markers.ptr<int>(r);
+		char* seed = seedMask.ptr<char>(r);
+		uchar* inside = band.ptr<uchar>(r);
+		for (int c = 0; c < markers.cols; c++) {
+			if (inBand[label[c]]) {
+				seed[c] = GraphCutSegmentation::UNKNOWN;
+				inside[c] = 255;
+				bandPixels++;
+			}
+			else {
+				seed[c] = coarse.isForegroundRegion(label[c]) ? GraphCutSegmentation::OBJECT : GraphCutSegmentation::BACKGROUND;
+			}
+		}
+	}
+
+	// The user's strokes stay hard constraints inside the band, points off
+	// the image are skipped like LazySnapping does
+	cv::Rect imgRect(cv::Point(), seedMask.size());
+	for (auto& p : hintBkg)
+		if (imgRect.contains(p))
+			seedMask.at<char>(p) = GraphCutSegmentation::BACKGROUND;
+	for (auto& p : hintObj)
+		if (imgRect.contains(p))
+			seedMask.at<char>(p) = GraphCutSegmentation::OBJECT;
+
+	return bandPixels;
+
+}
+
+void HybridSegmentation::segment(const cv::Mat& img, const std::vector<cv::Point>& hintBkg,
+	const std::vector<cv::Point>& hintObj, cv::Mat& outputMask) {
+
+	stageTimes.clear();
+
+	int64 start = cv::getTickCount();
+	coarse.setSourceImage(img);
+	coarse.setBackgroundPoints(hintBkg);
+	coarse.setForegroundPoints(hintObj);
+	coarse.setUpdateB(!hintBkg.empty());
+	coarse.setUpdateF(!hintObj.empty());
+	coarse.runMaxFlow();
+	stageTimes["coarse"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	for (auto& stage : coarse.getStageTimes())
+		stageTimes["coarse_" + stage.first] = stage.second;
+
+	start = cv::getTickCount();
+	std::vector<bool> inBand;
+	selectRegions(inBand);
+
+	cv::Mat seedMask;
+	int bandPixels = buildSeedMask(inBand, hintBkg, hintObj, seedMask);
+	stageTimes["band"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	// Nothing to refine, the coarse cut kept the whole image on one side
+	if (bandPixels == 0) {
+		outputMask = coarse.getMask();
+		return;
+	}
+
+	// Cluster about as many pixels as the band holds, the graph only has those
+	start = cv::getTickCount();
+	int numPix = img.rows * img.cols;
+	fine.setClusterSampleStep(numPix / std::max(bandPixels, MIN_CLUSTER_SAMPLES));
+	fine.segment(img, seedMask, outputMask);
+	fine.cleanGarbage();
+	stageTimes["fine"] = double(cv::getTickCount() - start) / cv::getTickFrequency();
+
+	for (auto& stage : fine.getStageTimes())
+		stageTimes["fine_" + stage.first] = stage.second;
+
+}
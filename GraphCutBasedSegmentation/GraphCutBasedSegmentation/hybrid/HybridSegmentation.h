@@ -0,0 +1,84 @@
+#ifndef HYBRID_SEGMENTATION_H_
+#define HYBRID_SEGMENTATION_H_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2\opencv.hpp>
+#include "..\graphcut\GraphCutSegmentation.h"
+#include "..\lazy\LazySnapping.h"
+
+// Coarse-to-fine segmentation: lazy snapping cuts the superpixel graph, then
+// the pixel graph cut refines only the superpixels along the coarse boundary.
+// All other pixels keep their coarse label as hard seeds.
+class HybridSegmentation {
+
+public:
+
+	HybridSegmentation();
+
+	// Rings of regions on each side of the coarse boundary that are refined
+	void setBandWidth(int);
+
+	// Seed of the colour clustering of both stages
+	void setSeed(uint64_t);
+
+	// Superpixel settings, cache and tuner are configured here
+	LazySnapping& getLazySnapping();
+
+	GraphCutSegmentation& getGraphCut();
+
+	void segment(const cv::Mat& img, const std::vector<cv::Point>& hintBkg,
+		const std::vector<cv::Point>& hintObj, cv::Mat& outputMask);
+
+	// 255 where the last segment() refined pixels
+	const cv::Mat& getBand() const;
+
+	// Seconds spent in each stage of the last segment() call
+	const std::map<std::string, double>& getStageTimes() const;
+
+private:
+
+	LazySnapping				coarse;
+	GraphCutSegmentation		fine;
+
+	int							bandWidth;
+	cv::Mat						band;
+
+	std::map<std::string, double>	stageTimes;
+
+	// Regions touching a region of the other label, grown by bandWidth - 1 rings
+	void						selectRegions(std::vector<bool>& inBand);
+
+	// Coarse label as hard seeds outside the band, user hints inside it
+	int							buildSeedMask(const std::vector<bool>& inBand, const std::vector<cv::Point>& hintBkg,
+									const std::vector<cv::Point>& hintObj, cv::Mat& seedMask);
+
+};
+
+inline void HybridSegmentation::setBandWidth(int _bandWidth) {
+	bandWidth = std::max(1, _bandWidth);
+}
+
+inline void HybridSegmentation::setSeed(uint64_t _seed) {
+	coarse.setSeed(_seed);
+	fine.setSeed(_seed);
+}
+
+inline LazySnapping& HybridSegmentation::getLazySnapping() {
+	return coarse;
+}
+
+inline GraphCutSegmentation& HybridSegmentation::getGraphCut() {
+	return fine;
+}
+
+inline const cv::Mat& HybridSegmentation::getBand() const {
+	return band;
+}
+
+inline const std::map<std::string, double>& HybridSegmentation::getStageTimes() const {
+	return stageTimes;
+}
+
+#endif /* HYBRID_SEGMENTATION_H_ */
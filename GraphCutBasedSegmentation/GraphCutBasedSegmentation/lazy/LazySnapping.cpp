@@ -1,17 +1,23 @@
 #include "LazySnapping.h"
-#include "watershedLabel.h"
 #include <iomanip>
+#include <algorithm>
+#include <cfloat>
 
 using namespace std;
 using namespace cv;
 
-LazySnapping::LazySnapping() : graph(NULL)
+// seedState flags
+const uchar FOREGROUND_SEED = 1;
+const uchar BACKGROUND_SEED = 2;
+
+LazySnapping::LazySnapping() : graph(NULL), cache(NULL)
 {
 	forePts.clear();
 	backPts.clear();
 	isWaterShed = false;
 	isUpdateF = false;
 	isUpdateB = false;
+	setClusterNumber(64);
 }
 
 LazySnapping::~LazySnapping()
@@ -26,219 +32,342 @@ LazySnapping::~LazySnapping()
 void LazySnapping::setSourceImage(Mat image)
 {
 	src = image.clone();
+
+	// seeds and superpixels belong to the previous image
+	seedState.release();
+	foregroundModel.reset();
+	backgroundModel.reset();
+	isWaterShed = false;
 }
 
-inline void LazySnapping::setUpdateF(bool value) { isUpdateF = value; }
+void LazySnapping::setClusterNumber(int value)
+{
+	foregroundModel.setClusterNumber(value);
+	backgroundModel.setClusterNumber(value);
+}
 
-inline void LazySnapping::setUpdateB(bool value) { isUpdateB = value; }
+void LazySnapping::setSeed(uint64_t seed)
+{
+	foregroundModel.setSeed(seed);
+	backgroundModel.setSeed(seed);
+}
 
-void LazySnapping::setForegroundPoints(vector<cv::Point> points)
+void LazySnapping::setSuperpixelCache(SuperpixelCache* superpixelCache, const string& key)
 {
-	forePts = points;
+	cache = superpixelCache;
+	cacheKey = key;
+	isWaterShed = false;
 }
 
-void LazySnapping::setBackgroundPoints(vector<cv::Point> points)
+void LazySnapping::setDiagnostics(bool enable, const string& directory)
 {
-	backPts = points;
+	watershed.setDiagnostics(enable, directory);
 }
 
-int LazySnapping::getComponentNumber(Mat markers)
+void LazySnapping::setSuperpixelParams(const SuperpixelParams& params)
 {
-	double result = 0;
-	cv::minMaxIdx(markers, NULL, &result);
-	return int(result + 1.0);
+	watershed.setParams(params);
+	isWaterShed = false;
 }
 
-void LazySnapping::k_meanForeground()
+void LazySnapping::setSuperpixelTuner(SuperpixelTuner* tuner)
 {
-	// K-mean for foreground seed
-	connectToSource = vector< bool >(n, false);
+	watershed.setTuner(tuner);
+	isWaterShed = false;
+}
 
-	for (auto &i : forePts)
+void LazySnapping::setForegroundPoints(vector<cv::Point> points)
+{
+	if (!extendsPoints(forePts, points))
 	{
-		if (0 <= i.y && i.y < markers.rows
-			&& 0 <= i.x && i.x <= markers.cols)
-		{
-			Vec3f idensity = src.at<Vec3b>(i.y, i.x);
-			foreground_seeds.push_back(idensity);
-			connectToSource[markers.at<int>(i.y, i.x)] = true;
-		}
+		forgetSeeds(FOREGROUND_SEED, foregroundModel);
+	}
+	forePts = points;
+}
+
+void LazySnapping::setBackgroundPoints(vector<cv::Point> points)
+{
+	if (!extendsPoints(backPts, points))
+	{
+		forgetSeeds(BACKGROUND_SEED, backgroundModel);
 	}
+	backPts = points;
+}
 
-	Mat label;
-	Mat center;
-	KF = K;
-	if (foreground_seeds.rows < KF)
+bool LazySnapping::extendsPoints(const vector<cv::Point>& oldPoints, const vector<cv::Point>& points)
+{
+	return points.size() >= oldPoints.size()
+		&& equal(oldPoints.begin(), oldPoints.end(), points.begin());
+}
+
+void LazySnapping::forgetSeeds(uchar side, ColorModel& model)
+{
+	if (!seedState.empty())
 	{
-		KF = foreground_seeds.rows;
+		bitwise_and(seedState, Scalar(uchar(~side)), seedState);
 	}
+	model.reset();
+}
 
-	kmeans(foreground_seeds,
-		KF,
-		label,
-		cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 50, 1.0),
-		1,
-		cv::KMEANS_RANDOM_CENTERS,
-		center);
+void LazySnapping::addForegroundPoints(const vector<cv::Point>& points)
+{
+	forePts.insert(forePts.end(), points.begin(), points.end());
+	setUpdateF(true);
+}
 
-	foreground_centers = center;
+void LazySnapping::addBackgroundPoints(const vector<cv::Point>& points)
+{
+	backPts.insert(backPts.end(), points.begin(), points.end());
+	setUpdateB(true);
 }
 
-void LazySnapping::k_meanBackground()
+void LazySnapping::collectSeeds(const vector<cv::Point>& points, uchar side, vector<bool>& connect, Mat& newSeeds)
 {
-	// K-mean for background seed
-	connectToSink = vector< bool >(n, false);
+	connect = vector< bool >(n, false);
+
+	if (seedState.empty())
+	{
+		seedState = Mat::zeros(markers.size(), CV_8U);
+	}
 
-	for (auto &i : backPts)
+	for (auto &i : points)
 	{
 		if (0 <= i.y && i.y < markers.rows
 			&& 0 <= i.x && i.x < markers.cols)
 		{
-			Vec3f idensity = src.at<Vec3b>(i.y, i.x);
-			background_seeds.push_back(idensity);
-			connectToSink[markers.at<int>(i.y, i.x)] = true;
-		}
-	}
+			connect[markers.at<int>(i.y, i.x)] = true;
 
-	Mat label;
-	Mat center;
-	KB = K;
-	if (background_seeds.rows < KB)
-	{
-		KB = background_seeds.rows;
+			// strokes are passed again on every run, their old pixels are already in the model
+			uchar& state = seedState.at<uchar>(i.y, i.x);
+			if (!(state & side))
+			{
+				state |= side;
+				newSeeds.push_back(Vec3f(src.at<Vec3b>(i.y, i.x)));
+			}
+		}
 	}
-
-	kmeans(background_seeds,
-		KB,
-		label,
-		cv::TermCriteria(CV_TERMCRIT_EPS + CV_TERMCRIT_ITER, 50, 1.0),
-		1,
-		cv::KMEANS_RANDOM_CENTERS,
-		center);
-
-	background_centers = center;
 }
 
-Vec3f LazySnapping::getAvgColor(const Mat dataPoints)
+void LazySnapping::k_meanForeground()
 {
-	auto colorAvg = cv::mean(dataPoints);
-	return{(float)colorAvg[0], (float)colorAvg[1], (float)colorAvg[2]};
+	// K-mean for foreground seed
+	Mat newSeeds;
+	collectSeeds(forePts, FOREGROUND_SEED, connectToSource, newSeeds);
+
+	// online update from the new stroke pixels only
+	foregroundModel.addSamples(newSeeds);
+
+	foreground_centers = foregroundModel.getCenters();
+	KF = foregroundModel.getClusterNumber();
 }
 
-void LazySnapping::BFS(int i, int j, int currentLabel, int reLabel, Mat markers, Mat & dataPoints, Mat & visited)
+void LazySnapping::k_meanBackground()
 {
-	// Create a queue for BFS
-	list<pair<int, int>> queue;
+	// K-mean for background seed
+	Mat newSeeds;
+	collectSeeds(backPts, BACKGROUND_SEED, connectToSink, newSeeds);
 
-	// Mark the current node as visited and enqueue it
-	visited.at<int>(i, j) = true;
-	queue.push_back(make_pair(i, j));
+	// online update from the new stroke pixels only
+	backgroundModel.addSamples(newSeeds);
 
-	int markers_rows = markers.rows;
-	int markers_cols = markers.cols;
+	background_centers = backgroundModel.getCenters();
+	KB = backgroundModel.getClusterNumber();
+}
 
-	while (!queue.empty())
+int LazySnapping::findRoot(vector<int>& parent, int label)
+{
+	while (parent[label] != label)
 	{
-		// Dequeue a vertex from queue and print it
-		int x = queue.front().first;
-		int y = queue.front().second;
-
-		Vec3f intensity = (Vec3f)src.at<Vec3b>(x, y);
-		dataPoints.push_back(intensity);
-
-		markers.at<int>(x, y) = reLabel;
+		// path halving
+		parent[label] = parent[parent[label]];
+		label = parent[label];
+	}
+	return label;
+}
 
-		queue.pop_front();
+int LazySnapping::unite(vector<int>& parent, int label1, int label2)
+{
+	int root1 = findRoot(parent, label1);
+	int root2 = findRoot(parent, label2);
 
-		// Get all adjacent vertices of the dequeued vertex s
-		// If a adjacent has not been visited, then mark it visited
-		// and enqueue it
-		for (int k = 0; k < 4; k++)
-		{
-			int xx = x + r[k];
-			int yy = y + c[k];
-
-			if (0 <= xx && xx < markers_rows
-				&& 0 <= yy && yy < markers_cols)
-				if (visited.at<int>(xx, yy) == 0)
-				{
-					int label = markers.at<int>(xx, yy);
-					if (currentLabel == label)
-					{
-						visited.at<int>(xx, yy) = 1;
-						queue.push_back(make_pair(xx, yy));
-					}
-				}
-		}
+	// the smaller provisional label is the first one met in raster order
+	if (root1 < root2)
+	{
+		parent[root2] = root1;
+		return root1;
 	}
+	parent[root1] = root2;
+	return root2;
 }
 
 void LazySnapping::initSuperPixel()
 {
-	Mat visited = Mat::zeros(markers.rows, markers.cols, CV_32S);
+	// Two-pass union-find over 4-connected pixels of equal marker.
+	// A marker split into several pieces gives one region per piece.
+	Mat provisional(markers.rows, markers.cols, CV_32S);
 
-	centers.resize(n * 10000);
+	vector<int> parent;
+	vector<Vec3d> colorSum;
+	vector<int> pixelCount;
 
-	int reLabel = 0;
-	for (int i = 0; i < markers.rows; i++)
+	for (int x = 0; x < markers.rows; x++)
 	{
-		for (int j = 0; j < markers.cols; j++)
-			if (visited.at<int>(i, j) == 0)
+		const int* row = markers.ptr<int>(x);
+		const int* upRow = x > 0 ? markers.ptr<int>(x - 1) : NULL;
+		int* label = provisional.ptr<int>(x);
+		const int* upLabel = x > 0 ? provisional.ptr<int>(x - 1) : NULL;
+		const Vec3b* color = src.ptr<Vec3b>(x);
+
+		for (int y = 0; y < markers.cols; y++)
+		{
+			int left = (y > 0 && row[y - 1] == row[y]) ? label[y - 1] : -1;
+			int up = (upRow && upRow[y] == row[y]) ? upLabel[y] : -1;
+
+			int current;
+			if (left < 0 && up < 0)
+			{
+				current = (int)parent.size();
+				parent.push_back(current);
+				colorSum.push_back(Vec3d(0, 0, 0));
+				pixelCount.push_back(0);
+			}
+			else if (left >= 0 && up >= 0)
 			{
-				Mat dataPoints;
-				int currentLabel = markers.at<int>(i, j);
-				BFS(i, j, currentLabel, reLabel, markers, dataPoints, visited);
-				centers[reLabel] = getAvgColor(dataPoints);
-				reLabel++;
+				current = (left == up) ? left : unite(parent, left, up);
 			}
+			else
+			{
+				current = max(left, up);
+			}
+
+			label[y] = current;
+			colorSum[current] += Vec3d(color[y][0], color[y][1], color[y][2]);
+			pixelCount[current]++;
+		}
+	}
+
+	// Compact the roots in raster order and fold the colour sums into them
+	vector<int> reLabel(parent.size());
+	n = 0;
+	for (int i = 0; i < (int)parent.size(); i++)
+	{
+		int root = findRoot(parent, i);
+		if (root == i)
+		{
+			reLabel[i] = n++;
+		}
+		else
+		{
+			reLabel[i] = reLabel[root];
+			colorSum[root] += colorSum[i];
+			pixelCount[root] += pixelCount[i];
+		}
 	}
 
-	n = reLabel;
+	centers.assign(n, Vec3f());
+	for (int i = 0; i < (int)parent.size(); i++)
+	{
+		if (parent[i] == i)
+		{
+			Vec3d avg = colorSum[i] * (1.0 / pixelCount[i]);
+			centers[reLabel[i]] = Vec3f((float)avg[0], (float)avg[1], (float)avg[2]);
+		}
+	}
+
+	for (int x = 0; x < provisional.rows; x++)
+	{
+		int* label = provisional.ptr<int>(x);
+		for (int y = 0; y < provisional.cols; y++)
+		{
+			label[y] = reLabel[label[y]];
+		}
+	}
 
+	markers = provisional;
 }
 
 void LazySnapping::initNeighboring()
 {
-	connected = Mat::zeros(n, n, CV_32S);
+	adjacency.assign(n, vector<RegionEdge>());
 
+	// one pass over the right and down neighbours finds every boundary pair once,
+	// the edge is counted on the smaller label only
 	for (int x = 0; x < markers.rows; x++)
+	{
+		const int* row = markers.ptr<int>(x);
+		const int* nextRow = (x + 1 < markers.rows) ? markers.ptr<int>(x + 1) : NULL;
+
 		for (int y = 0; y < markers.cols; y++)
 		{
-			int currentLabel = markers.at<int>(x, y);
-			for (int k = 0; k < 4; k++)
+			int currentLabel = row[y];
+
+			if (y + 1 < markers.cols && row[y + 1] != currentLabel)
 			{
-				int xx = x + r[k];
-				int yy = y + c[k];
-
-				if (0 <= xx && xx < markers.rows
-					&& 0 <= yy && yy < markers.cols)
-				{
-					int label = markers.at<int>(xx, yy);
-					if (currentLabel != label)
-					{
-						connected.at<int>(currentLabel, label) = 1;
-						connected.at<int>(label, currentLabel) = 1;
-					}
-				}
+				addBoundary(currentLabel, row[y + 1]);
+			}
+			if (nextRow && nextRow[y] != currentLabel)
+			{
+				addBoundary(currentLabel, nextRow[y]);
 			}
 		}
+	}
 
+	// mirror the edges onto the larger label
+	for (int i = 0; i < n; i++)
+	{
+		int count = (int)adjacency[i].size();
+		for (int k = 0; k < count; k++)
+		{
+			RegionEdge &edge = adjacency[i][k];
+			if (edge.to > i)
+			{
+				edge.colorDiff = colorDistance(centers[i], centers[edge.to]);
+				adjacency[edge.to].push_back({ i, edge.boundary, edge.colorDiff });
+			}
+		}
+	}
+
+	// sorted lists give the same graph whether built here or loaded from a cache
+	for (auto &edges : adjacency)
+	{
+		sort(edges.begin(), edges.end(),
+			[](const RegionEdge& a, const RegionEdge& b) { return a.to < b.to; });
+	}
+}
+
+void LazySnapping::addBoundary(int label1, int label2)
+{
+	vector<RegionEdge> &edges = adjacency[min(label1, label2)];
+	int to = max(label1, label2);
+
+	// regions have a handful of neighbours, a linear search beats a map
+	for (auto &edge : edges)
+	{
+		if (edge.to == to)
+		{
+			edge.boundary++;
+			return;
+		}
+	}
+
+	edges.push_back({ to, 1, 0.0f });
 }
 
 void LazySnapping::initSegment()
 {
-	// Get number of segment
-	n = getComponentNumber(markers);
 	initSuperPixel();
 	initNeighboring();
 }
 
 void LazySnapping::initWaterShed()
 {
-	Watershed Watershed;
-	Watershed.setSourceImage(src);
-	Watershed.setMarkers(markers);
-	markers = Watershed.getMarkersLabel();
+	watershed.setSourceImage(src);
+	watershed.setMarkers(markers);
+	if (!cacheKey.empty())
+	{
+		watershed.setDebugName(cacheKey);
+	}
+	markers = watershed.getMarkersLabel();
 }
 
 void LazySnapping::initSeeds()
@@ -256,29 +385,85 @@ void LazySnapping::initSeeds()
 
 void LazySnapping::initMarkers()
 {
-	initWaterShed();
-	initSegment();
+	int64 start = getTickCount();
+
+	SuperpixelData data;
+	SuperpixelParams params = watershed.getParamsFor(src.size());
+	if (cache && cache->find(cacheKey, src, params, data))
+	{
+		n = data.n;
+		markers = data.markers;
+		centers = data.centers;
+		adjacency = data.adjacency;
+	}
+	else
+	{
+		initWaterShed();
+		initSegment();
+
+		if (cache)
+		{
+			data.n = n;
+			data.markers = markers;
+			data.centers.assign(centers.begin(), centers.begin() + n);
+			data.adjacency = adjacency;
+			cache->store(cacheKey, src, watershed.getLastParams(), data);
+		}
+	}
+	isWaterShed = true;
+
+	stageTimes["superpixel"] = double(getTickCount() - start) / getTickFrequency();
 }
 
-void LazySnapping::getE1(int currentLabel, double * energy)
+static void splitChannels(const Mat& centers, int k, vector<float>& planes)
 {
-	// average distance
-	double df = INFINNITE_MAX;
-	double db = INFINNITE_MAX;
-	for (int i = 0; i < KF; i++)
+	planes.resize(3 * k);
+	for (int i = 0; i < k; i++)
 	{
-		double mindf = norm(centers[currentLabel], foreground_centers.at<Vec3f>(i, 0), NORM_L2);
-		df = min(df, mindf);
+		Vec3f center = centers.at<Vec3f>(i, 0);
+		planes[i] = center[0];
+		planes[k + i] = center[1];
+		planes[2 * k + i] = center[2];
 	}
+}
 
-	for (int i = 0; i < KB; i++)
+static float nearestSquaredDistance(const vector<float>& planes, int k, const Vec3f& color)
+{
+	const float* c0 = planes.data();
+	const float* c1 = c0 + k;
+	const float* c2 = c1 + k;
+
+	float best = FLT_MAX;
+	for (int i = 0; i < k; i++)
 	{
-		double mindb = norm(centers[currentLabel], background_centers.at<Vec3f>(i, 0), NORM_L2);
-		db = min(db, mindb);
+		float d0 = c0[i] - color[0];
+		float d1 = c1[i] - color[1];
+		float d2 = c2[i] - color[2];
+		best = min(best, d0 * d0 + d1 * d1 + d2 * d2);
 	}
+	return best;
+}
 
-	energy[0] = df / (db + df);
-	energy[1] = db / (db + df);
+void LazySnapping::getE1(vector<double>& toSource, vector<double>& toSink)
+{
+	// At most clusters centres per side: a flat scan over channel planes with
+	// squared distances is cheaper than any spatial index.
+	vector<float> forePlanes, backPlanes;
+	splitChannels(foreground_centers, KF, forePlanes);
+	splitChannels(background_centers, KB, backPlanes);
+
+	toSource.resize(n);
+	toSink.resize(n);
+
+	for (int i = 0; i < n; i++)
+	{
+		// average distance
+		double df = KF > 0 ? sqrt((double)nearestSquaredDistance(forePlanes, KF, centers[i])) : INFINNITE_MAX;
+		double db = KB > 0 ? sqrt((double)nearestSquaredDistance(backPlanes, KB, centers[i])) : INFINNITE_MAX;
+
+		toSource[i] = df / (db + df);
+		toSink[i] = db / (db + df);
+	}
 }
 
 float LazySnapping::colorDistance(Vec3f color1, Vec3f color2)
@@ -288,60 +473,115 @@ float LazySnapping::colorDistance(Vec3f color1, Vec3f color2)
 		(color1[2] - color2[2])*(color1[2] - color2[2]));
 }
 
-float LazySnapping::getE2(int xlabel, int ylabel)
+float LazySnapping::getE2(const RegionEdge& edge)
 {
 	const float EPSILON = 1;
 	float lambda = 10;
 
-	float distance = colorDistance(centers[xlabel], centers[ylabel]);
-	return (float)lambda / (EPSILON + distance);
+	return (float)lambda / (EPSILON + edge.colorDiff);
 }
 
 void LazySnapping::initGraph()
 {
-	initMarkers();
-
-	graph = new GraphType(n, 8 * n);
-
-	double e1[2], e2[2];
+	// the pre-segmentation depends on the image only
+	if (!isWaterShed)
+	{
+		initMarkers();
+	}
 
-	graph->add_node(n);
+	int64 start = getTickCount();
+	if (graph)
+	{
+		graph->reset();
+		delete graph;
+		graph = NULL;
+	}
 
+	// Seeded regions keep their side, only the others become nodes
+	regionNode.assign(n, -1);
+	int nodeCount = 0;
 	for (int i = 0; i < n; i++)
 	{
-		// calculate E1 energy
-		if (connectToSource[i])
+		if (!connectToSource[i] && !connectToSink[i])
 		{
-			e1[0] = 0;
-			e1[1] = INFINNITE_MAX;
-		}
-		else if (connectToSink[i])
-		{
-			e1[0] = INFINNITE_MAX;
-			e1[1] = 0;
-		}
-		else
-		{
-			getE1(i, e1);
+			regionNode[i] = nodeCount++;
 		}
+	}
 
-		graph->add_tweights(i, e1[0], e1[1]);
+	// Every region is seeded, the labels come from the strokes alone
+	if (nodeCount == 0)
+	{
+		stageTimes["graph"] = double(getTickCount() - start) / getTickFrequency();
+		return;
+	}
 
-		for (int j = i + 1; j < n; j++)
-			if (connected.at<int>(i, j) == 1)
+	int edgeCount = 0;
+	for (int i = 0; i < n; i++)
+	{
+		if (regionNode[i] < 0)
+			continue;
+		for (auto &edge : adjacency[i])
+			if (regionNode[edge.to] >= 0)
+				edgeCount++;
+	}
+	graph = new GraphType(max(nodeCount, 1), max(edgeCount / 2, 1));
+
+	vector<double> e1Source, e1Sink;
+	getE1(e1Source, e1Sink);
+
+	graph->add_node(nodeCount);
+
+	for (int i = 0; i < n; i++)
+	{
+		int node = regionNode[i];
+		if (node < 0)
+			continue;
+
+		// calculate E1 energy, plus E2 towards seeded neighbours whose side is fixed
+		double toSource = e1Source[i], toSink = e1Sink[i];
+
+		for (auto &edge : adjacency[i])
+		{
+			int neighborNode = regionNode[edge.to];
+			if (neighborNode > node)
+			{
+				float e2 = getE2(edge);
+				graph->add_edge(node, neighborNode, e2, e2);
+			}
+			else if (neighborNode < 0)
 			{
-				float e2 = getE2(i, j);
-				graph->add_edge(i, j, e2, e2);
+				if (connectToSource[edge.to])
+					toSink += getE2(edge);
+				else
+					toSource += getE2(edge);
 			}
+		}
+
+		graph->add_tweights(node, toSource, toSink);
 	}
+	stageTimes["graph"] = double(getTickCount() - start) / getTickFrequency();
 }
 
 void LazySnapping::runMaxFlow()
 {
+	if (!isWaterShed)
+	{
+		initMarkers();
+	}
+
+	int64 start = getTickCount();
 	initSeeds();
+	stageTimes["seeds"] = double(getTickCount() - start) / getTickFrequency();
+
 	initGraph();
-	float flowValue = graph->maxflow();
+
+	start = getTickCount();
+	if (graph)
+	{
+		graph->maxflow();
+	}
 	getLabellingValue();
+	stageTimes["maxflow"] = double(getTickCount() - start) / getTickFrequency();
 
 	setUpdateF(false);
 	setUpdateB(false);
@@ -352,11 +592,16 @@ void LazySnapping::getLabellingValue()
 	FLabel.resize(n);
 
 	for (int i = 0; i < n; i++)
-		if (graph->what_segment(i) == GraphType::SOURCE)
+		if (regionNode[i] < 0)
+		{
+			// foreground seeds are tied to the sink
+			FLabel[i] = connectToSource[i] ? 0 : 1;
+		}
+		else if (graph->what_segment(regionNode[i]) == GraphType::SOURCE)
 		{
 			FLabel[i] = 1;
 		}
-		else if (graph->what_segment(i) == GraphType::SINK)
+		else if (graph->what_segment(regionNode[i]) == GraphType::SINK)
 		{
 			FLabel[i] = 0;
 		}
@@ -386,6 +631,24 @@ IplImage * LazySnapping::getImageMask()
 	return gray;
 }
 
+cv::Mat LazySnapping::getMask()
+{
+	cv::Mat mask = Mat::zeros(markers.rows, markers.cols, CV_8U);
+	for (int h = 0; h < markers.rows; h++)
+	{
+		for (int w = 0; w < markers.cols; w++)
+		{
+			// foreground seeds are tied to the sink
+			if (FLabel[markers.at<int>(h, w)] == 0)
+			{
+				mask.at<uchar>(h, w) = 255;
+			}
+		}
+	}
+
+	return mask;
+}
+
 cv::Mat LazySnapping::getImageColor()
 {
 	cv::Mat showImg = src.clone();
@@ -3,13 +3,15 @@
 
 #include <opencv2\opencv.hpp>
 #include "..\max_flow\graph.h"
+#include "SuperpixelCache.h"
+#include "watershedLabel.h"
+#include "..\common\ColorModel.h"
 #include <vector>
 #include <iostream>
 #include <cmath>
-#include <list>
 #include <fstream>
-
-#define K 64
+#include <map>
+#include <string>
 
 const double INFINNITE_MAX = 1e10;
 
@@ -22,30 +24,34 @@ private:
 	
 	cv::Mat src;
 
-	// Graph info
+	// Graph info, NULL when every region is seeded
 	GraphType* graph;
 
 	// pre-segmentation component number
 	int n;
 
-	cv::Mat connected;
-	cv::Mat visited;
+	// region adjacency graph, one edge list per region
+	RegionAdjacency adjacency;
 	std::vector< cv::Vec3f > centers;
 
 	// Foreground K-mean
-	cv::Mat foreground_seeds;
 	cv::Mat foreground_centers;
 	
 	// Background K-mean
-	cv::Mat background_seeds;
 	cv::Mat background_centers;
 
+	// per pixel, which side already fed its colour to the k-means
+	cv::Mat seedState;
+
 	// Segment connect to Source
 	std::vector< bool > connectToSource;
 
 	// Segment connect to Sink
 	std::vector< bool > connectToSink;
 
+	// Region to graph node, -1 for seeded regions which are left out of the graph
+	std::vector< int > regionNode;
+
 	// Final labelling
 	std::vector < int > FLabel;
 
@@ -53,40 +59,60 @@ private:
 	bool isUpdateF;
 	bool isUpdateB;
 
+	// k-means of the seed colours, warm-started between strokes
+	ColorModel foregroundModel;
+	ColorModel backgroundModel;
+
 	int KF;
 	int KB;
 
 	cv::Mat markers;
 	bool isWaterShed;
 
-	const int r[4] = { 0, 1, 0,-1 };
-	const int c[4] = { 1, 0,-1, 0 };
+	// kept alive so that its debug dump can finish in the background
+	Watershed watershed;
+
+	// pre-segmentation shared between cuts of the same image
+	SuperpixelCache* cache;
+	std::string cacheKey;
 
-	int getComponentNumber(cv::Mat markers);
+	std::map<std::string, double> stageTimes;
 
 	void k_meanForeground();
 
 	void k_meanBackground();
 
-	cv::Vec3f getAvgColor(const cv::Mat dataPoints);
+	// Marks the regions of points and returns the colours of pixels not ingested for this side yet
+	void collectSeeds(const std::vector<cv::Point>& points, uchar side, std::vector<bool>& connect, cv::Mat& newSeeds);
+
+	// true if points is oldPoints with more points appended
+	static bool extendsPoints(const std::vector<cv::Point>& oldPoints, const std::vector<cv::Point>& points);
 
-	void BFS(int i, int j, int currentLabel, int reLabel, cv::Mat markers, cv::Mat &dataPoints, cv::Mat &visited);
+	// Drops the seed pixels of one side from seedState and its model
+	void forgetSeeds(uchar side, ColorModel& model);
+
+	static int findRoot(std::vector<int>& parent, int label);
+
+	static int unite(std::vector<int>& parent, int label1, int label2);
 
 	void initSuperPixel();
 
 	void initNeighboring();
 
+	void addBoundary(int label1, int label2);
+
 	void initSegment();
 
 	void initWaterShed();
 
 	void initSeeds();
 
-	void getE1(int currentLabel, double* energy);
+	// E1 of every region against the nearest foreground and background centre
+	void getE1(std::vector<double>& toSource, std::vector<double>& toSink);
 
 	float colorDistance(cv::Vec3f color1, cv::Vec3f color2);
 
-	float getE2(int xlabel, int ylabel);
+	float getE2(const RegionEdge& edge);
 
 	void initGraph();
 
@@ -98,24 +124,69 @@ public:
 
 	void setSourceImage(cv::Mat image);
 
+	// Reuse the pre-segmentation stored under key, or compute and store it
+	void setSuperpixelCache(SuperpixelCache* superpixelCache, const std::string& key);
+
+	// Off by default; when on, a contour image of each pre-segmentation is written to directory
+	void setDiagnostics(bool enable, const std::string& directory = "");
+
+	// Used as is unless a tuner is set
+	void setSuperpixelParams(const SuperpixelParams& params);
+
+	// Pick the superpixel params per image instead, tuner must outlive this object
+	void setSuperpixelTuner(SuperpixelTuner* tuner);
+
+	// Superpixel params of the last pre-segmentation computed by this object
+	const SuperpixelParams& getSuperpixelParams() const { return watershed.getLastParams(); }
+
+	// k-means clusters per side, at most
+	void setClusterNumber(int value);
+
+	// Seed of both k-means, equal seeds give equal masks
+	void setSeed(uint64_t seed);
+
 	void setUpdateF(bool value);
 	void setUpdateB(bool value);
 
+	// Unless points extend the current list, the strokes are replaced and
+	// this side's colour model starts over
 	void setForegroundPoints(std::vector<cv::Point> points);
 
 	void setBackgroundPoints(std::vector<cv::Point> points);
 
+	// Append a stroke, only its new pixels are clustered on the next run
+	void addForegroundPoints(const std::vector<cv::Point>& points);
+
+	void addBackgroundPoints(const std::vector<cv::Point>& points);
+
 	void initMarkers();
 
 	void runMaxFlow();
 
 	IplImage* getImageMask();
 
+	// Foreground (sink) regions as 255, background as 0
+	cv::Mat getMask();
+
+	// Pre-segmentation of the last run: region label per pixel and region adjacency
+	const cv::Mat& getMarkers() const { return markers; }
+	const RegionAdjacency& getAdjacency() const { return adjacency; }
+	int getRegionNumber() const { return n; }
+
+	bool isForegroundRegion(int region) const { return FLabel[region] == 0; }
+
 	cv::Mat getImageColor();
 
 	cv::Mat changeLabelSegment(int x, int y);
 
+	// Seconds spent in each stage of the last runMaxFlow() call
+	const std::map<std::string, double>& getStageTimes() const { return stageTimes; }
+
 };
 
+inline void LazySnapping::setUpdateF(bool value) { isUpdateF = value; }
+
+inline void LazySnapping::setUpdateB(bool value) { isUpdateB = value; }
+
 #endif
 
@@ -65,6 +65,7 @@
 #include <opencv2/opencv.hpp>
 #include <math.h>
 #include <string>
+#include <vector>
 
 SEEDSRevised::SEEDSRevised(const cv::Mat &image, int numberOfLevels, int minimumBlockWidth, int minimumBlockHeight, int numberOfBins, int neighborhoodSize, float minimumConfidence) {
     this->construct(image, numberOfBins, numberOfLevels, minimumBlockWidth, minimumBlockHeight, neighborhoodSize, minimumConfidence);
@@ -134,8 +135,11 @@ void SEEDSRevised::construct(const cv::Mat &image, int numberOfBins, int numberO
     this->minimumNumberOfSublabels = 1;
     this->histogramDimensions = 0;
     this->histogramSize = 0;
+    this->parallel = false;
+    this->minimumChangeFraction = 0;
     
     this->image = new cv::Mat();
+    this->initializedImage = true;
     int channels = image.channels();
     
     assert(channels == 1 || channels == 3);
@@ -158,49 +162,14 @@ SEEDSRevised::~SEEDSRevised() {
         delete this->image;
     }
     
+    // The buffers are cv::Mat members, only the row pointers are owned here.
     if (this->initializedLabels == true) {
-        
-        for (int i = 0; i < this->height; ++i) {
-            delete[] this->currentLabels[i];
-            delete[] this->spatialMemory[i];
-        }
-        
         delete[] this->currentLabels;
         delete[] this->spatialMemory;
         this->initializedLabels = false;
     }
     
     if (this->initializedHistograms == true) {
-        
-        int blockHeightNumber;
-        int blockWidthNumber;
-        
-        for (int level = 1; level <= this->numberOfLevels; ++level) {
-            blockHeightNumber = this->getBlockHeightNumber(level);
-            blockWidthNumber = this->getBlockWidthNumber(level);
-
-            // Note that the array is built up as a matrix: the first index references
-            // the row rather than the column.
-            for (int i = 0; i < blockHeightNumber; ++i) {
-                for (int j = 0; j < blockWidthNumber; ++j) {
-                    delete[] this->histograms[level - 1][i][j];
-                }
-                
-                delete[] this->histograms[level - 1][i];
-                delete[] this->pixels[level - 1][i];
-            }
-            
-            delete[] this->histograms[level - 1];
-            delete[] this->pixels[level - 1];
-        }
-        
-        delete[] this->histograms;
-        delete[] this->pixels;
-        
-        for (int i = 0; i < this->height; ++i) {
-            delete[] this->histogramBins[i];
-        }
-        
         delete[] this->histogramBins;
         this->initializedHistograms = false;
     }
@@ -236,6 +205,16 @@ void SEEDSRevised::setNumberOfBins(int numberOfBins) {
     this->numberOfBins = numberOfBins;
 }
 
+void SEEDSRevised::setParallel(bool parallel) {
+    this->parallel = parallel;
+}
+
+void SEEDSRevised::setMinimumChangeFraction(float minimumChangeFraction) {
+    assert(minimumChangeFraction >= 0);
+    
+    this->minimumChangeFraction = minimumChangeFraction;
+}
+
 void SEEDSRevised::initialize() {
     this->initializeLabels();
     this->initializeHistograms();
@@ -265,12 +244,13 @@ void SEEDSRevised::initializeLabels() {
     // In the end each pixel will have a label, in the meantime we will simply only 
     // use a part of the matrix for the block labels such that we do not need
     // to resize the matrix at each level.
+    this->labelData.create(this->height, this->width, CV_32S);
     this->currentLabels = new int*[this->height];
     
     // Initialize labels in blocks of 4 blocks, as 4 blocks built one superpixel
     // at the level above.
     for (int i = 0; i < this->height; ++i) {
-        this->currentLabels[i] = new int[this->width];
+        this->currentLabels[i] = this->labelData.ptr<int>(i);
         
         for (int j = 0; j < this->width; ++j) {
             
@@ -287,9 +267,10 @@ void SEEDSRevised::initializeLabels() {
     
     // Spatial memory will remember which blocks or pixels have been updated in the
     // previous iteration, and for which blocks or pixels there will not be a change.
+    this->spatialMemoryData.create(this->height, this->width, CV_8U);
     this->spatialMemory = new bool*[this->height];
     for (int i = 0; i < this->height; ++i) {
-        this->spatialMemory[i] = new bool[this->width];
+        this->spatialMemory[i] = reinterpret_cast<bool*>(this->spatialMemoryData.ptr<uchar>(i));
         
         for (int j = 0; j < this->width; ++j) {
             this->spatialMemory[i][j] = true;
@@ -386,15 +367,8 @@ void SEEDSRevised::goDownOneLevel() {
     }
     else if (this->currentLevel == 0) {
 
-        int** blockLabels = new int*[this->currentBlockHeightNumber];
-        
-        for (int i = 0; i < this->currentBlockHeightNumber; ++i) {
-            blockLabels[i] = new int[this->currentBlockWidthNumber];
-            
-            for (int j = 0; j < this->currentBlockWidthNumber; ++j) {
-                blockLabels[i][j] = this->currentLabels[i][j];
-            }
-        }
+        // Block labels occupy the top left corner of the label buffer.
+        cv::Mat blockLabels = this->labelData(cv::Rect(0, 0, this->currentBlockWidthNumber, this->currentBlockHeightNumber)).clone();
         
         for (int i = 0; i < this->currentBlockHeightNumber; ++i) {
             
@@ -413,15 +387,12 @@ void SEEDSRevised::goDownOneLevel() {
                 
                 for (int k = this->minimumBlockHeight*i; k < heightEnd; ++k) {
                     for (int l = this->minimumBlockWidth*j; l < widthEnd; ++l) {
-                        this->currentLabels[k][l] = blockLabels[i][j];
+                        this->currentLabels[k][l] = blockLabels.at<int>(i, j);
                     }
                 }
             }
         }
         
-        // Remember to free temporary labels.
-        delete[] blockLabels;
-        
         // Pixel level.
         this->currentBlockWidth = 1;
         this->currentBlockHeight = 1;
@@ -456,14 +427,14 @@ void SEEDSRevised::goDownOneLevel() {
                     for (int j = 0; j < blockWidthNumber; ++j) {
                         sum = 0;
                         for (int k = 0; k < this->histogramSize; ++k) {
-                            sum += this->histograms[level - 1][i][j][k];
+                            sum += this->histogramAt(level - 1, i, j)[k];
                         }
 
 //                        if (level < this->numberOfLevels) {
-//                            assert(this->pixels[level - 1][i][j] >= blockWidth*blockHeight);
+//                            assert(this->pixelsAt(level - 1, i, j) >= blockWidth*blockHeight);
 //                        }
                         
-                        assert(this->pixels[level - 1][i][j] == sum);
+                        assert(this->pixelsAt(level - 1, i, j) == sum);
                     }
                 }
             }
@@ -479,9 +450,10 @@ void SEEDSRevised::initializeHistograms() {
     #ifdef UNIFORM
         int denominator = ceil(256./((double) this->numberOfBins));
          
+        this->histogramBinData.create(this->height, this->width, CV_32S);
         this->histogramBins = new int*[this->height];
         for (int i = 0; i < this->height; ++i) {
-            this->histogramBins[i] = new int[this->width];
+            this->histogramBins[i] = this->histogramBinData.ptr<int>(i);
 
             for (int j = 0; j < this->width; ++j) {
                 this->histogramBins[i][j] = this->histogramSize;
@@ -534,9 +506,10 @@ void SEEDSRevised::initializeHistograms() {
 
         int equiHeight = ceil(((double) (count + 1))/((double) this->numberOfBins));
         
+        this->histogramBinData.create(this->height, this->width, CV_32S);
         this->histogramBins = new int*[this->height];
         for (int i = 0; i < this->height; ++i) {
-            this->histogramBins[i] = new int[this->width];
+            this->histogramBins[i] = this->histogramBinData.ptr<int>(i);
 
             for (int j = 0; j < this->width; ++j) {
                 this->histogramBins[i][j] = this->histogramSize;
@@ -569,24 +542,26 @@ void SEEDSRevised::initializeHistograms() {
     int blockHeightEnd;
     int blockWidthEnd;
 
-    this->histograms = new int***[this->numberOfLevels];
-    this->pixels = new int**[this->numberOfLevels];
-
-    this->histograms[0] = new int**[minimumBlockHeightNumber];
-    this->pixels[0] = new int*[minimumBlockHeightNumber];
+    // All levels share one buffer of block histograms and one of pixel counts.
+    // A histogram is padded to a whole number of cache lines.
+    this->histogramStride = (this->histogramSize + 15)/16*16;
+    this->levelOffsets.resize(this->numberOfLevels + 1);
+    this->levelWidthNumbers.resize(this->numberOfLevels);
+    this->levelOffsets[0] = 0;
+    
+    for (int level = 1; level <= this->numberOfLevels; ++level) {
+        this->levelWidthNumbers[level - 1] = this->getBlockWidthNumber(level);
+        this->levelOffsets[level] = this->levelOffsets[level - 1] + this->getBlockHeightNumber(level)*this->getBlockWidthNumber(level);
+    }
+    
+    this->histogramData = cv::Mat::zeros(1, this->levelOffsets[this->numberOfLevels]*this->histogramStride, CV_32S);
+    this->pixelData = cv::Mat::zeros(1, this->levelOffsets[this->numberOfLevels], CV_32S);
         
     for (int i = 0; i < minimumBlockHeightNumber; ++i) {
-        this->histograms[0][i] = new int*[minimumBlockWidthNumber];
-        this->pixels[0][i] = new int[minimumBlockWidthNumber];
-
         for (int j = 0; j < minimumBlockWidthNumber; ++j) {
-            this->histograms[0][i][j] = new int[this->histogramSize];
-            this->pixels[0][i][j] = 0;
-
-            // Initialize histogram bins.
-            for (int k = 0; k < this->histogramSize; ++k) {
-                this->histograms[0][i][j][k] = 0;
-            }
+            // Both buffers start zeroed.
+            int* histogram = this->histogramAt(0, i, j);
+            int pixels = 0;
 
             // Remember the borders, blockHeightEnd and blockWidthEnd
             // are exclusive indices.
@@ -607,11 +582,14 @@ void SEEDSRevised::initializeHistograms() {
             #endif
 
             for (int k = i*this->minimumBlockHeight; k < blockHeightEnd; ++k) {
+                const int* bins = this->histogramBins[k];
                 for (int l = j*this->minimumBlockWidth; l < blockWidthEnd; ++l) {
-                    ++this->pixels[0][i][j];
-                    ++this->histograms[0][i][j][this->histogramBins[k][l]];
+                    ++histogram[bins[l]];
                 }
+                pixels += blockWidthEnd - j*this->minimumBlockWidth;
             }
+
+            this->pixelsAt(0, i, j) = pixels;
         }
     }
 
@@ -623,68 +601,73 @@ void SEEDSRevised::initializeHistograms() {
     // Calculate histograms at the higher levels by accumulating the histograms
     // at the levels below. First block level is level 1, so we start with level 2.
 
-    // Remember that the used index in this->histograms is on less than the level number.
+    // Remember that the level index of histogramAt is one less than the level number.
     for (int level = 2; level <= this->numberOfLevels; ++level) {
         blockHeightNumber = this->getBlockHeightNumber(level);
         blockWidthNumber = this->getBlockWidthNumber(level);
         blockHeightNumberBelow = this->getBlockHeightNumber(level - 1);
         blockWidthNumberBelow = this->getBlockWidthNumber(level - 1);
 
-        this->histograms[level - 1] = new int**[blockHeightNumber];
-        this->pixels[level - 1] = new int*[blockHeightNumber];
-
         for (int i = 0; i < blockHeightNumber; ++i) {
-            this->histograms[level - 1][i] = new int*[blockWidthNumber];
-            this->pixels[level - 1][i] = new int[blockWidthNumber];
-
             for (int j = 0; j < blockWidthNumber; ++j) {
-                this->histograms[level - 1][i][j] = new int[this->histogramSize];
-
-                this->pixels[level - 1][i][j] = this->pixels[level - 2][2*i][2*j];
-                this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i + 1][2*j];
-                this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i][2*j + 1];
-                this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i + 1][2*j + 1];
+                this->pixelsAt(level - 1, i, j) = this->pixelsAt(level - 2, 2*i, 2*j);
+                this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i + 1, 2*j);
+                this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i, 2*j + 1);
+                this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i + 1, 2*j + 1);
 
                 if (i == blockHeightNumber - 1 && 2*i + 2 < blockHeightNumberBelow) {
-                    this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i + 2][2*j];
-                    this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i + 2][2*j + 1];
+                    this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i + 2, 2*j);
+                    this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i + 2, 2*j + 1);
                 }
 
                 if (j == blockWidthNumber - 1 && 2*j + 2 < blockWidthNumberBelow) {
-                    this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i][2*j + 2];
-                    this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i + 1][2*j + 2];
+                    this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i, 2*j + 2);
+                    this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i + 1, 2*j + 2);
                 }
 
                 if (i == blockHeightNumber - 1 && j == blockWidthNumber - 1
                         && 2*i + 2 < blockHeightNumberBelow && 2*j + 2 < blockWidthNumberBelow) {
-                    this->pixels[level - 1][i][j] += this->pixels[level - 2][2*i + 2][2*j + 2];
+                    this->pixelsAt(level - 1, i, j) += this->pixelsAt(level - 2, 2*i + 2, 2*j + 2);
                 }
 
-                for (int k = 0; k < this->histogramSize; ++k) {
-                    this->histograms[level - 1][i][j][k] = this->histograms[level - 2][2*i][2*j][k];
-                    this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i + 1][2*j][k];
-                    this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i][2*j + 1][k];
-                    this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i + 1][2*j + 1][k];
+                // Sum the children, the last row and column also absorb the
+                // remainder blocks of the level below.
+                int* histogram = this->histogramAt(level - 1, i, j);
+                const int* children[9];
+                int numberOfChildren = 0;
 
-                    if (i == blockHeightNumber - 1 && 2*i + 2 < blockHeightNumberBelow) {
-                        this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i + 2][2*j][k];
-                        this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i + 2][2*j + 1][k];
-                    }
+                children[numberOfChildren++] = this->histogramAt(level - 2, 2*i, 2*j);
+                children[numberOfChildren++] = this->histogramAt(level - 2, 2*i + 1, 2*j);
+                children[numberOfChildren++] = this->histogramAt(level - 2, 2*i, 2*j + 1);
+                children[numberOfChildren++] = this->histogramAt(level - 2, 2*i + 1, 2*j + 1);
 
-                    if (j == blockWidthNumber - 1 && 2*j + 2 < blockWidthNumberBelow) {
-                        this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i][2*j + 2][k];
-                        this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i + 1][2*j + 2][k];
-                    }
+                if (i == blockHeightNumber - 1 && 2*i + 2 < blockHeightNumberBelow) {
+                    children[numberOfChildren++] = this->histogramAt(level - 2, 2*i + 2, 2*j);
+                    children[numberOfChildren++] = this->histogramAt(level - 2, 2*i + 2, 2*j + 1);
+                }
 
-                    if (i == blockHeightNumber - 1 && j == blockWidthNumber - 1
-                            && 2*i + 2 < blockHeightNumberBelow && 2*j + 2 < blockWidthNumberBelow) {
-                        this->histograms[level - 1][i][j][k] += this->histograms[level - 2][2*i + 2][2*j + 2][k];
-                    }
+                if (j == blockWidthNumber - 1 && 2*j + 2 < blockWidthNumberBelow) {
+                    children[numberOfChildren++] = this->histogramAt(level - 2, 2*i, 2*j + 2);
+                    children[numberOfChildren++] = this->histogramAt(level - 2, 2*i + 1, 2*j + 2);
+                }
+
+                if (i == blockHeightNumber - 1 && j == blockWidthNumber - 1
+                        && 2*i + 2 < blockHeightNumberBelow && 2*j + 2 < blockWidthNumberBelow) {
+                    children[numberOfChildren++] = this->histogramAt(level - 2, 2*i + 2, 2*j + 2);
+                }
 
-                    #ifdef DEBUG
-                        assert(this->histograms[level - 1][i][j][k] <= this->pixels[level - 1][i][j]);
-                    #endif
+                for (int c = 0; c < numberOfChildren; ++c) {
+                    const int* child = children[c];
+                    for (int k = 0; k < this->histogramSize; ++k) {
+                        histogram[k] += child[k];
+                    }
                 }
+
+                #ifdef DEBUG
+                    for (int k = 0; k < this->histogramSize; ++k) {
+                        assert(histogram[k] <= this->pixelsAt(level - 1, i, j));
+                    }
+                #endif
             }
         }
     }
@@ -708,11 +691,11 @@ void SEEDSRevised::initializeHistograms() {
                 for (int j = 0; j < blockWidthNumber; ++j) {
                     sum = 0;
                     for (int k = 0; k < this->histogramSize; ++k) {
-                        sum += this->histograms[level - 1][i][j][k];
+                        sum += this->histogramAt(level - 1, i, j)[k];
                     }
                     
-                    assert(this->pixels[level - 1][i][j] >= blockWidth*blockHeight);
-                    assert(this->pixels[level - 1][i][j] == sum);
+                    assert(this->pixelsAt(level - 1, i, j) >= blockWidth*blockHeight);
+                    assert(this->pixelsAt(level - 1, i, j) == sum);
                 }
             }
         }
@@ -747,7 +730,7 @@ void SEEDSRevised::performBlockUpdate(int i, int j) {
             int iSuperpixelFrom = this->getSuperpixelIFromLabel(labelFrom);
             int jSuperpixelFrom = this->getSuperpixelJFromLabel(labelFrom);
 
-            int blocks = this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom]/this->pixels[this->currentLevel - 1][i][j];
+            int blocks = this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom)/this->pixelsAt(this->currentLevel - 1, i, j);
             if (blocks > this->minimumNumberOfSublabels) {
 
                 float currentScore = this->scoreCurrentBlockSegmentation(i, j, iSuperpixelFrom, jSuperpixelFrom);
@@ -861,7 +844,7 @@ void SEEDSRevised::performPixelUpdate(int i, int j) {
             int iSuperpixelFrom = this->getSuperpixelIFromLabel(labelFrom);
             int jSuperpixelFrom = this->getSuperpixelJFromLabel(labelFrom);
 
-            if (this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] > this->minimumNumberOfSublabels) {
+            if (this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom) > this->minimumNumberOfSublabels) {
 
                 float currentScore = this->scoreCurrentPixelSegmentation(i, j, iSuperpixelFrom, jSuperpixelFrom);
 
@@ -943,6 +926,193 @@ void SEEDSRevised::performPixelUpdate(int i, int j) {
     }
 }
 
+template <class Seeds>
+bool SEEDSRevised::proposePixelUpdate(Seeds* seeds, int i, int j, PixelMove& move) {
+    
+    if (seeds->spatialMemory[i][j] == false) {
+        return false;
+    }
+    
+    #ifdef MEMORY
+        // Will be set to true in the case the pixel is moved.
+        seeds->spatialMemory[i][j] = false;
+    #endif
+    
+    int iPlusOne = std::min(i + 1, seeds->height - 1);
+    int iMinusOne = std::max(i - 1, 0);
+    int jPlusOne = std::min(j + 1, seeds->width - 1);
+    int jMinusOne = std::max(j - 1, 0);
+    
+    int labelFrom = seeds->currentLabels[i][j];
+    int labelVerticalForward = seeds->currentLabels[iPlusOne][j];
+    int labelVerticalBackward = seeds->currentLabels[iMinusOne][j];
+    int labelHorizontalForward = seeds->currentLabels[i][jPlusOne];
+    int labelHorizontalBackward = seeds->currentLabels[i][jMinusOne];
+    
+    if (labelVerticalForward == labelFrom
+            && labelVerticalBackward == labelFrom
+            && labelHorizontalForward == labelFrom
+            && labelHorizontalBackward == labelFrom) {
+        return false;
+    }
+    
+    int iSuperpixelFrom = seeds->getSuperpixelIFromLabel(labelFrom);
+    int jSuperpixelFrom = seeds->getSuperpixelJFromLabel(labelFrom);
+    
+    if (seeds->pixelsAt(seeds->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom) <= seeds->minimumNumberOfSublabels) {
+        return false;
+    }
+    
+    float currentScore = seeds->Seeds::scoreCurrentPixelSegmentation(i, j, iSuperpixelFrom, jSuperpixelFrom);
+    
+    // Candidates in the order of the serial update: down, up, right, left.
+    int iCandidates[4] = {iPlusOne, iMinusOne, i, i};
+    int jCandidates[4] = {j, j, jPlusOne, jMinusOne};
+    int labelCandidates[4] = {labelVerticalForward, labelVerticalBackward, labelHorizontalForward, labelHorizontalBackward};
+    
+    float bestScore = 0.;
+    move.i = i;
+    move.j = j;
+    
+    for (int k = 0; k < 4; ++k) {
+        if (labelCandidates[k] == labelFrom) {
+            continue;
+        }
+        
+        bool split = false;
+        switch (k) {
+            case 0: split = seeds->checkSplitVerticalForward(i, j, iPlusOne, iMinusOne, jPlusOne, jMinusOne); break;
+            case 1: split = seeds->checkSplitVerticalBackward(i, j, iPlusOne, iMinusOne, jPlusOne, jMinusOne); break;
+            case 2: split = seeds->checkSplitHorizontalForward(i, j, iPlusOne, iMinusOne, jPlusOne, jMinusOne); break;
+            case 3: split = seeds->checkSplitHorizontalBackward(i, j, iPlusOne, iMinusOne, jPlusOne, jMinusOne); break;
+        }
+        
+        if (split) {
+            continue;
+        }
+        
+        int iSuperpixelTo = seeds->getSuperpixelIFromLabel(labelCandidates[k]);
+        int jSuperpixelTo = seeds->getSuperpixelJFromLabel(labelCandidates[k]);
+        
+        float proposedScore = seeds->Seeds::scoreProposedPixelSegmentation(i, j, iSuperpixelTo, jSuperpixelTo);
+        float score = seeds->Seeds::scorePixelUpdate(i, j, iCandidates[k], jCandidates[k], currentScore, proposedScore);
+        
+        if (score > 0 && score > bestScore) {
+            move.iTo = iCandidates[k];
+            move.jTo = jCandidates[k];
+            bestScore = score;
+        }
+    }
+    
+    return bestScore > 0;
+}
+
+template <class Seeds>
+bool SEEDSRevised::applyPixelUpdate(Seeds* seeds, const PixelMove& move) {
+    
+    int i = move.i;
+    int j = move.j;
+    
+    int labelFrom = seeds->currentLabels[i][j];
+    int labelTo = seeds->currentLabels[move.iTo][move.jTo];
+    
+    int iSuperpixelFrom = seeds->getSuperpixelIFromLabel(labelFrom);
+    int jSuperpixelFrom = seeds->getSuperpixelJFromLabel(labelFrom);
+    
+    if (seeds->pixelsAt(seeds->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom) <= seeds->minimumNumberOfSublabels) {
+        return false;
+    }
+    
+    int iPlusOne = std::min(i + 1, seeds->height - 1);
+    int iMinusOne = std::max(i - 1, 0);
+    int jPlusOne = std::min(j + 1, seeds->width - 1);
+    int jMinusOne = std::max(j - 1, 0);
+    
+    seeds->Seeds::updatePixel(i, j, move.iTo, move.jTo, iSuperpixelFrom, jSuperpixelFrom,
+            seeds->getSuperpixelIFromLabel(labelTo), seeds->getSuperpixelJFromLabel(labelTo),
+            iPlusOne, iMinusOne, jPlusOne, jMinusOne);
+    
+    return true;
+}
+
+/**
+ * Scores the pixels of one checkerboard phase on a range of rows.
+ */
+template <class Seeds>
+class PixelUpdateProposer : public cv::ParallelLoopBody {
+
+public:
+    
+    PixelUpdateProposer(Seeds* seeds, int iPhase, int jPhase, std::vector< std::vector<typename Seeds::PixelMove> >& moves)
+        : seeds(seeds), iPhase(iPhase), jPhase(jPhase), moves(moves) {}
+    
+    virtual void operator()(const cv::Range& range) const {
+        typename Seeds::PixelMove move;
+        
+        for (int r = range.start; r < range.end; ++r) {
+            int i = 2*r + this->iPhase;
+            
+            this->moves[i].clear();
+            for (int j = this->jPhase; j < this->seeds->width; j += 2) {
+                if (Seeds::proposePixelUpdate(this->seeds, i, j, move)) {
+                    this->moves[i].push_back(move);
+                }
+            }
+        }
+    }
+    
+private:
+    
+    Seeds* seeds;
+    int iPhase;
+    int jPhase;
+    std::vector< std::vector<typename Seeds::PixelMove> >& moves;
+};
+
+template <class Seeds>
+void SEEDSRevised::performPixelUpdates(Seeds* seeds, int iterations) {
+    
+    int minimumChanges = (int) (seeds->minimumChangeFraction*seeds->height*seeds->width);
+    std::vector< std::vector<PixelMove> > moves(seeds->parallel ? seeds->height : 0);
+    
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+        
+        int changes = 0;
+        
+        if (seeds->parallel) {
+            // No two pixels of a phase are 8-neighbors, so the labels read
+            // while scoring are not changed by the moves of the same phase.
+            for (int phase = 0; phase < 4; ++phase) {
+                int iPhase = phase/2;
+                int jPhase = phase%2;
+                int rows = (seeds->height - iPhase + 1)/2;
+                
+                cv::parallel_for_(cv::Range(0, rows), PixelUpdateProposer<Seeds>(seeds, iPhase, jPhase, moves));
+                
+                for (int r = 0; r < rows; ++r) {
+                    for (auto &move : moves[2*r + iPhase]) {
+                        changes += applyPixelUpdate(seeds, move) ? 1 : 0;
+                    }
+                }
+            }
+        }
+        else {
+            PixelMove move;
+            for (int i = 0; i < seeds->height; ++i) {
+                for (int j = 0; j < seeds->width; ++j) {
+                    if (proposePixelUpdate(seeds, i, j, move)) {
+                        changes += applyPixelUpdate(seeds, move) ? 1 : 0;
+                    }
+                }
+            }
+        }
+        
+        if (changes <= minimumChanges) {
+            break;
+        }
+    }
+}
+
 void SEEDSRevised::iterate(int iterations) {
     
     while (this->currentLevel > 0) {
@@ -960,13 +1130,7 @@ void SEEDSRevised::iterate(int iterations) {
     }
         
     this->reinitializeSpatialMemory();
-    for (int iteration = 0; iteration < 2*iterations; ++iteration) {
-        for (int i = 0; i < this->height; ++i) {
-            for (int j = 0; j < this->width; ++j) {
-                this->performPixelUpdate(i, j);
-            }
-        }
-    }
+    performPixelUpdates(this, 2*iterations);
 }
 
 void SEEDSRevised::reinitializeSpatialMemory() {
@@ -987,6 +1151,12 @@ int** SEEDSRevised::getLabels() const {
     return this->currentLabels;
 }
 
+cv::Mat SEEDSRevised::getLabelsMat() const {
+    assert(this->initializedLabels);
+    
+    return this->labelData;
+}
+
 int SEEDSRevised::getNumberOfSuperpixels() const {
     return this->getBlockHeightNumber(this->numberOfLevels)*this->getBlockWidthNumber(this->numberOfLevels);
 }
@@ -1010,35 +1180,8 @@ SEEDSRevisedMeanPixels::SEEDSRevisedMeanPixels(const cv::Mat& image, int desired
 }
 
 SEEDSRevisedMeanPixels::~SEEDSRevisedMeanPixels() {
-    
-    if (this->initializedMeans == true) {
-        
-        for (int i = 0; i < this->height; ++i) {
-            for (int j = 0; j < this->width; ++j) {
-                delete[] this->means[0][i][j];
-            }
-            
-            delete[] this->means[0][i];
-        }
-        
-        delete[] this->means[0];
-        
-        int superpixelHeightNumber = this->getBlockHeightNumber(this->numberOfLevels);
-        int superpixelWidthNumber = this->getBlockWidthNumber(this->numberOfLevels);
-        
-        for (int i = 0; i < superpixelHeightNumber; ++i) {
-            for (int j = 0; j < superpixelWidthNumber; ++j) {
-                delete[] this->means[1][i][j];
-            }
-
-            delete[] this->means[1][i];
-        }
-        
-        delete[] this->means[1];
-        delete[] this->means;
-        
-        this->initializedMeans = false;
-    }
+    // The mean buffers are released by their cv::Mat members.
+    this->initializedMeans = false;
 }
 
 void SEEDSRevisedMeanPixels::iterate(int iterations) {
@@ -1059,57 +1202,34 @@ void SEEDSRevisedMeanPixels::iterate(int iterations) {
     
     this->initializeMeans();
     this->reinitializeSpatialMemory();
-    for (int iteration = 0; iteration < 2*iterations; ++iteration) {
-        for (int i = 0; i < this->height; ++i) {
-            for (int j = 0; j < this->width; ++j) {
-                this->performPixelUpdate(i, j);
-            }
-        }
-    }
+    performPixelUpdates(this, 2*iterations);
 }
 
 void SEEDSRevisedMeanPixels::initializeMeans() {
     this->meanDimensions = this->histogramDimensions + 2;
     
-    this->means = new float***[2];
-    this->means[0] = new float**[this->height];
-    this->means[1] = new float**[this->superpixelHeightNumber];
-    
-    for (int i = 0; i < this->superpixelHeightNumber; ++i) {
-        this->means[1][i] = new float*[this->superpixelWidthNumber];
-        
-        for (int j = 0; j < this->superpixelWidthNumber; ++j) {
-            this->means[1][i][j] = new float[this->meanDimensions];
-            
-            for (int k = 0; k < this->meanDimensions; ++k) {
-                this->means[1][i][j][k] = 0;
-            }
-        }
-    }
+    this->pixelMeans.create(this->height*this->width, this->meanDimensions, CV_32F);
+    this->superpixelMeans = cv::Mat::zeros(this->superpixelHeightNumber*this->superpixelWidthNumber, this->meanDimensions, CV_32F);
     
     for (int i = 0; i < this->height; ++i) {
-        this->means[0][i] = new float*[this->width];
-        
         for (int j = 0; j < this->width; ++j) {
-            this->means[0][i][j] = new float[this->meanDimensions];
-            
             if (this->histogramDimensions == 1) {
-                this->means[0][i][j][0] = this->image->at<unsigned char>(i, j);
+                this->pixelMeanAt(i, j)[0] = this->image->at<unsigned char>(i, j);
             }
             else if (this->histogramDimensions == 3) {
-                this->means[0][i][j][0] = this->image->at<cv::Vec3b>(i, j)[0];
-                this->means[0][i][j][1] = this->image->at<cv::Vec3b>(i, j)[1];
-                this->means[0][i][j][2] = this->image->at<cv::Vec3b>(i, j)[2];
+                this->pixelMeanAt(i, j)[0] = this->image->at<cv::Vec3b>(i, j)[0];
+                this->pixelMeanAt(i, j)[1] = this->image->at<cv::Vec3b>(i, j)[1];
+                this->pixelMeanAt(i, j)[2] = this->image->at<cv::Vec3b>(i, j)[2];
             }
             
-            this->means[0][i][j][this->meanDimensions - 2] = j;
-            this->means[0][i][j][this->meanDimensions - 1] = i;
+            this->pixelMeanAt(i, j)[this->meanDimensions - 2] = j;
+            this->pixelMeanAt(i, j)[this->meanDimensions - 1] = i;
             
             int iSuperpixel = this->getSuperpixelIFromLabel(this->currentLabels[i][j]);
             int jSuperpixel = this->getSuperpixelJFromLabel(this->currentLabels[i][j]);
             
             for (int k = 0; k < this->meanDimensions; ++k) {
-                this->means[1][iSuperpixel][jSuperpixel][k] += this->means[0][i][j][k];
+                this->superpixelMeanAt(iSuperpixel, jSuperpixel)[k] += this->pixelMeanAt(i, j)[k];
             }
         }
     }
@@ -1122,14 +1242,14 @@ void SEEDSRevisedMeanPixels::initializeMeans() {
         for (int i = 0; i < superpixelHeightNumber; ++i) {
             for (int j = 0; j < superpixelWidthNumber; ++j) {
                 for (int k = 0; k < this->histogramDimensions; ++k) {
-                    float mean = this->means[1][i][j][k]/this->pixels[this->numberOfLevels - 1][i][j];
+                    float mean = this->superpixelMeanAt(i, j)[k]/this->pixelsAt(this->numberOfLevels - 1, i, j);
                     assert(mean <= 255);
                 }
                 
-                float mean = this->means[1][i][j][this->meanDimensions - 2]/this->pixels[this->numberOfLevels - 1][i][j];
+                float mean = this->superpixelMeanAt(i, j)[this->meanDimensions - 2]/this->pixelsAt(this->numberOfLevels - 1, i, j);
                 assert(mean <= this->width);
                 
-                mean = this->means[1][i][j][this->meanDimensions - 1]/this->pixels[this->numberOfLevels - 1][i][j];
+                mean = this->superpixelMeanAt(i, j)[this->meanDimensions - 1]/this->pixelsAt(this->numberOfLevels - 1, i, j);
                 assert(mean <= this->height);
             }
         }
@@ -63,6 +63,7 @@
  */
 #include <opencv2/opencv.hpp>
 #include <string>
+#include <vector>
 #include <assert.h>
 
 #ifndef SEEDS_REVISED_H
@@ -124,8 +125,15 @@
  * 
  * @author David Stutz
  */
+template <class Seeds>
+class PixelUpdateProposer;
+
 class SEEDSRevised {
 
+    // Scores the moves of one checkerboard phase in parallel.
+    template <class Seeds>
+    friend class PixelUpdateProposer;
+
 public:
     
     /**
@@ -227,6 +235,14 @@ public:
      */
     int** getLabels() const;
 
+    /**
+     * Get the computed labels as CV_32S matrix of the image size. The matrix
+     * shares its buffer with getLabels(), no copy is made.
+     * 
+     * @return
+     */
+    cv::Mat getLabelsMat() const;
+
     /**
      * Set the number of levels to use. The number of levels influences the 
      * number of superpixels to be computed. See the documentation of the
@@ -274,6 +290,26 @@ public:
      */
     void setNeighborhoodSize(int neighborhoodSize);
 
+    /**
+     * Run the pixel updates in parallel. Pixels are visited in four phases of
+     * a 2 x 2 checkerboard so that no two pixels of a phase are 8-neighbors.
+     * Within a phase, moves are scored concurrently against the superpixel
+     * statistics at the start of the phase and then applied in scan order.
+     * Results differ slightly from the serial sweep.
+     * 
+     * @param bool parallel
+     */
+    void setParallel(bool parallel);
+
+    /**
+     * Stop the pixel updates once an iteration moves at most the given
+     * fraction of all pixels. With 0, only iterations moving no pixel at all
+     * are cut, which does not change the result.
+     * 
+     * @param float minimumChangeFraction
+     */
+    void setMinimumChangeFraction(float minimumChangeFraction);
+
     /**
      * Initialize the algorithm on the given image. After initialization,
      * iterations can be run using the iterate method.
@@ -352,6 +388,52 @@ public:
 
 protected:
 
+    /**
+     * A pixel move found during a pixel update: the pixel takes the label of
+     * the neighbor (iTo, jTo).
+     */
+    struct PixelMove {
+        int i;
+        int j;
+        int iTo;
+        int jTo;
+    };
+
+    /**
+     * Score the moves of pixel (i, j) to its 4-neighbors and return the best
+     * one, if any. Scores are called qualified on Seeds, so the sweep over all
+     * pixels is not dispatched virtually per call.
+     * 
+     * @param Seeds* seeds
+     * @param int i
+     * @param int j
+     * @param PixelMove& move
+     * @return
+     */
+    template <class Seeds>
+    static bool proposePixelUpdate(Seeds* seeds, int i, int j, PixelMove& move);
+
+    /**
+     * Apply a proposed move. Returns false if the source superpixel became
+     * too small since the move was scored.
+     * 
+     * @param Seeds* seeds
+     * @param PixelMove& move
+     * @return
+     */
+    template <class Seeds>
+    static bool applyPixelUpdate(Seeds* seeds, const PixelMove& move);
+
+    /**
+     * Run the given number of pixel update iterations, serially or in
+     * parallel, with early termination.
+     * 
+     * @param Seeds* seeds
+     * @param int iterations
+     */
+    template <class Seeds>
+    static void performPixelUpdates(Seeds* seeds, int iterations);
+
     /**
      * Proxy for multiple constructors.
      */
@@ -382,16 +464,19 @@ protected:
         float currentScore = 0.;
         float difference = 0.;
 
-        float superpixelMinusBlockPixels = this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->pixels[this->currentLevel - 1][iFrom][jFrom];
-        float blockPixels = this->pixels[this->currentLevel - 1][iFrom][jFrom];
+        float superpixelMinusBlockPixels = this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom) - this->pixelsAt(this->currentLevel - 1, iFrom, jFrom);
+        float blockPixels = this->pixelsAt(this->currentLevel - 1, iFrom, jFrom);
+
+        const int* blockHistogram = this->histogramAt(this->currentLevel - 1, iFrom, jFrom);
+        const int* superpixelHistogram = this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom);
 
         for (int k = 0; k < this->histogramSize; ++k) {
 
-            if (this->histograms[this->currentLevel - 1][iFrom][jFrom][k] > 0 
-                    && this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][k] > this->histograms[this->currentLevel - 1][iFrom][jFrom][k]) {
+            if (blockHistogram[k] > 0 
+                    && superpixelHistogram[k] > blockHistogram[k]) {
 
-                difference = this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][k] - this->histograms[this->currentLevel - 1][iFrom][jFrom][k];
-                currentScore += std::min(difference/superpixelMinusBlockPixels, this->histograms[this->currentLevel - 1][iFrom][jFrom][k]/blockPixels);
+                difference = superpixelHistogram[k] - blockHistogram[k];
+                currentScore += std::min(difference/superpixelMinusBlockPixels, blockHistogram[k]/blockPixels);
             }
         }
 
@@ -411,15 +496,18 @@ protected:
     virtual inline float scoreProposedBlockSegmentation(int iFrom, int jFrom, int iSuperpixelTo, int jSuperpixelTo) {
         float proposedScore = 0.;
 
-        float superpixelPixels = this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo];
-        float blockPixels = this->pixels[this->currentLevel - 1][iFrom][jFrom];
+        float superpixelPixels = this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo);
+        float blockPixels = this->pixelsAt(this->currentLevel - 1, iFrom, jFrom);
+
+        const int* blockHistogram = this->histogramAt(this->currentLevel - 1, iFrom, jFrom);
+        const int* superpixelHistogram = this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo);
 
         for (int k = 0; k < this->histogramSize; ++k) {
 
-            if (this->histograms[this->currentLevel - 1][iFrom][jFrom][k] > 0
-                    && this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][k] > 0) {
+            if (blockHistogram[k] > 0
+                    && superpixelHistogram[k] > 0) {
 
-                proposedScore += std::min(this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][k]/superpixelPixels, this->histograms[this->currentLevel - 1][iFrom][jFrom][k]/blockPixels);
+                proposedScore += std::min(superpixelHistogram[k]/superpixelPixels, blockHistogram[k]/blockPixels);
             }
         }
 
@@ -445,12 +533,17 @@ protected:
     virtual inline void updateBlock(int iFrom, int jFrom, int iTo, int jTo, int iSuperpixelFrom, int jSuperpixelFrom, int iSuperpixelTo, int jSuperpixelTo, int iPlusOne, int iMinusOne, int jPlusOne, int jMinusOne) {
         this->currentLabels[iFrom][jFrom] = this->currentLabels[iTo][jTo];
 
-        this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] -= this->pixels[this->currentLevel - 1][iFrom][jFrom];
-        this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] += this->pixels[this->currentLevel - 1][iFrom][jFrom];
+        this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom) -= this->pixelsAt(this->currentLevel - 1, iFrom, jFrom);
+        this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo) += this->pixelsAt(this->currentLevel - 1, iFrom, jFrom);
 
-        for (int k = 0; k < this->histogramSize; ++k) {
-            this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][k] -= this->histograms[this->currentLevel - 1][iFrom][jFrom][k];
-            this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][k] += this->histograms[this->currentLevel - 1][iFrom][jFrom][k];
+        const int* blockHistogram = this->histogramAt(this->currentLevel - 1, iFrom, jFrom);
+        int* superpixelFromHistogram = this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom);
+        int* superpixelToHistogram = this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo);
+        int size = this->histogramSize;
+
+        for (int k = 0; k < size; ++k) {
+            superpixelFromHistogram[k] -= blockHistogram[k];
+            superpixelToHistogram[k] += blockHistogram[k];
         }
 
         #ifdef MEMORY
@@ -473,12 +566,12 @@ protected:
             int sumFrom = 0;
             int sumTo = 0;
             for (int k = 0; k < this->histogramSize; ++k) {
-                sumFrom += this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][k];
-                sumTo += this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][k];
+                sumFrom += this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom)[k];
+                sumTo += this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo)[k];
             }
 
-            assert(sumFrom == this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom]);
-            assert(sumTo == this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo]);
+            assert(sumFrom == this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom));
+            assert(sumTo == this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo));
         #endif
     }
 
@@ -494,10 +587,10 @@ protected:
      */
     virtual inline float scoreCurrentPixelSegmentation(int iFrom, int jFrom, int iSuperpixelFrom, int jSuperpixelFrom) {
         #ifdef DEBUG
-            assert(this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][this->histogramBins[iFrom][jFrom]] <= this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom]);
+            assert(this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom)[this->histogramBins[iFrom][jFrom]] <= this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom));
         #endif
 
-        return ((float) this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][this->histogramBins[iFrom][jFrom]])/((float) this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom]);
+        return ((float) this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom)[this->histogramBins[iFrom][jFrom]])/((float) this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom));
     }
 
     /**
@@ -512,10 +605,10 @@ protected:
      */
     virtual inline float scoreProposedPixelSegmentation(int iFrom, int jFrom, int iSuperpixelTo, int jSuperpixelTo) {
         #ifdef DEBUG
-            assert(this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][this->histogramBins[iFrom][jFrom]] <= this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo]);
+            assert(this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo)[this->histogramBins[iFrom][jFrom]] <= this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo));
         #endif
 
-        return ((float) this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][this->histogramBins[iFrom][jFrom]])/((float) this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo]);
+        return ((float) this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo)[this->histogramBins[iFrom][jFrom]])/((float) this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo));
 
     }
 
@@ -583,11 +676,12 @@ protected:
     virtual inline void updatePixel(int iFrom, int jFrom, int iTo, int jTo, int iSuperpixelFrom, int jSuperpixelFrom, int iSuperpixelTo, int jSuperpixelTo, int iPlusOne, int iMinusOne, int jPlusOne, int jMinusOne) {
         this->currentLabels[iFrom][jFrom] = this->currentLabels[iTo][jTo];
 
-        --this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom];
-        ++this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo];
+        --this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom);
+        ++this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo);
 
-        --this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][this->histogramBins[iFrom][jFrom]];
-        ++this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][this->histogramBins[iFrom][jFrom]];
+        int bin = this->histogramBins[iFrom][jFrom];
+        --this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom)[bin];
+        ++this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo)[bin];
 
         #ifdef MEMORY
             #ifdef HEURISTIC_MEMORY
@@ -609,15 +703,39 @@ protected:
             int sumFrom = 0;
             int sumTo = 0;
             for (int k = 0; k < this->histogramSize; ++k) {
-                sumFrom += this->histograms[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom][k];
-                sumTo += this->histograms[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo][k];
+                sumFrom += this->histogramAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom)[k];
+                sumTo += this->histogramAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo)[k];
             }
 
-            assert(sumFrom == this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom]);
-            assert(sumTo == this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo]);
+            assert(sumFrom == this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom));
+            assert(sumTo == this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo));
         #endif
     }
 
+    /**
+     * Get the histogram of block (i, j) at the given level index (level - 1).
+     * 
+     * @param int level
+     * @param int i
+     * @param int j
+     * @return
+     */
+    inline int* histogramAt(int level, int i, int j) const {
+        return (int*) this->histogramData.data + (size_t) (this->levelOffsets[level] + i*this->levelWidthNumbers[level] + j)*this->histogramStride;
+    }
+
+    /**
+     * Get the pixel count of block (i, j) at the given level index (level - 1).
+     * 
+     * @param int level
+     * @param int i
+     * @param int j
+     * @return
+     */
+    inline int& pixelsAt(int level, int i, int j) const {
+        return ((int*) this->pixelData.data)[this->levelOffsets[level] + i*this->levelWidthNumbers[level] + j];
+    }
+
     /**
      * Get the first index for the given superpixel label.
      * 
@@ -956,8 +1074,13 @@ protected:
     /**
      * The current labels: At pixel level these will be the current superpixels,
      * at a block level, these correspond to block labelings.
+     * Row pointers into labelData.
      */
     int** currentLabels;
+    /**
+     * Contiguous height x width label buffer.
+     */
+    cv::Mat labelData;
     /**
      * The current level.
      */
@@ -1000,13 +1123,26 @@ protected:
     bool initializedLabels;
 
     /**
-     * Color histograms at all levels including superpixels.
+     * Color histograms of all blocks at all levels including superpixels,
+     * level after level in row-major block order, histogramStride ints each.
+     */
+    cv::Mat histogramData;
+    /**
+     * Pixel counts for all blocks and superpixels in the same order.
+     */
+    cv::Mat pixelData;
+    /**
+     * Index of the first block of each level in histogramData and pixelData.
      */
-    int**** histograms;
+    std::vector<int> levelOffsets;
     /**
-     * Pixel counts for all blocks and superpixels.
+     * Horizontal number of blocks of each level.
      */
-    int*** pixels;
+    std::vector<int> levelWidthNumbers;
+    /**
+     * Histogram size rounded up to whole cache lines.
+     */
+    int histogramStride;
     /**
      * The dimension of each histogram = 3 for color images.
      */
@@ -1017,8 +1153,10 @@ protected:
     int histogramSize;
     /**
      * The histogram bin assigned to each pixel stored in a two-dimensional array.
+     * Row pointers into histogramBinData.
      */
     int** histogramBins;
+    cv::Mat histogramBinData;
     /**
      * Boolean whether the histograms have been initialized.
      */
@@ -1026,8 +1164,20 @@ protected:
 
     /**
      * Memory used to speed up the algorithm.
+     * Row pointers into spatialMemoryData.
      */
     bool** spatialMemory;
+    cv::Mat spatialMemoryData;
+    
+    /**
+     * Whether pixel updates run in parallel.
+     */
+    bool parallel;
+    
+    /**
+     * Fraction of moved pixels below which the pixel updates stop.
+     */
+    float minimumChangeFraction;
 };
 
 /**
@@ -1041,6 +1191,9 @@ protected:
  */
 class SEEDSRevisedMeanPixels : public SEEDSRevised {
 
+    // The pixel update templates of the base class call the scores of this class.
+    friend class SEEDSRevised;
+
 public:
 
     /**
@@ -1152,18 +1305,21 @@ protected:
 
         SEEDSRevised::updatePixel(iFrom, jFrom, iTo, jTo, iSuperpixelFrom, jSuperpixelFrom, iSuperpixelTo, jSuperpixelTo, iPlusOne, iMinusOne, jPlusOne, jMinusOne);
 
+        const float* pixelMean = this->pixelMeanAt(iFrom, jFrom);
+        float* superpixelFromMean = this->superpixelMeanAt(iSuperpixelFrom, jSuperpixelFrom);
+        float* superpixelToMean = this->superpixelMeanAt(iSuperpixelTo, jSuperpixelTo);
         for (int k = 0; k < this->meanDimensions; ++k) {
-            this->means[1][iSuperpixelFrom][jSuperpixelFrom][k] -= this->means[0][iFrom][jFrom][k];
-            this->means[1][iSuperpixelTo][jSuperpixelTo][k] += this->means[0][iFrom][jFrom][k];
+            superpixelFromMean[k] -= pixelMean[k];
+            superpixelToMean[k] += pixelMean[k];
         }
 
         #ifdef DEBUG
             float mean = 0.;
             for (int k = 0; k < this->histogramDimensions; ++k) {
-                mean = this->means[1][iSuperpixelFrom][jSuperpixelFrom][k]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom];
+                mean = this->superpixelMeanAt(iSuperpixelFrom, jSuperpixelFrom)[k]/this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom);
                 assert(mean <= 255);
 
-                mean = this->means[1][iSuperpixelTo][jSuperpixelTo][k]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo];
+                mean = this->superpixelMeanAt(iSuperpixelTo, jSuperpixelTo)[k]/this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo);
                 assert(mean <= 255);
             }
         #endif
@@ -1180,17 +1336,20 @@ protected:
      * @return 
      */
     virtual inline float scoreCurrentPixelSegmentation(int iFrom, int jFrom, int iSuperpixelFrom, int jSuperpixelFrom) {
+        const float* pixelMean = this->pixelMeanAt(iFrom, jFrom);
+        const float* superpixelMean = this->superpixelMeanAt(iSuperpixelFrom, jSuperpixelFrom);
+        float pixels = this->pixelsAt(this->numberOfLevels - 1, iSuperpixelFrom, jSuperpixelFrom);
         float currentColorScore = 0.;
 
         if (this->histogramDimensions == 1) {
-            float difference = this->means[1][iSuperpixelFrom][jSuperpixelFrom][0]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->means[0][iFrom][jFrom][0];
+            float difference = superpixelMean[0]/pixels - pixelMean[0];
 
             currentColorScore = difference*difference/this->colorNormalization;
         }
         else {
-            float differenceL = this->means[1][iSuperpixelFrom][jSuperpixelFrom][0]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->means[0][iFrom][jFrom][0];
-            float differenceA = this->means[1][iSuperpixelFrom][jSuperpixelFrom][1]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->means[0][iFrom][jFrom][1];
-            float differenceB = this->means[1][iSuperpixelFrom][jSuperpixelFrom][2]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->means[0][iFrom][jFrom][2];
+            float differenceL = superpixelMean[0]/pixels - pixelMean[0];
+            float differenceA = superpixelMean[1]/pixels - pixelMean[1];
+            float differenceB = superpixelMean[2]/pixels - pixelMean[2];
 
             currentColorScore = (differenceL*differenceL + differenceA*differenceA + differenceB*differenceB)/this->colorNormalization;
         }
@@ -1200,8 +1359,8 @@ protected:
         #endif
 
         if (this->spatialWeight > 0) {
-            float differenceX = this->means[1][iSuperpixelFrom][jSuperpixelFrom][this->meanDimensions - 2]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->means[0][iFrom][jFrom][this->meanDimensions - 2];
-            float differenceY = this->means[1][iSuperpixelFrom][jSuperpixelFrom][this->meanDimensions - 1]/this->pixels[this->numberOfLevels - 1][iSuperpixelFrom][jSuperpixelFrom] - this->means[0][iFrom][jFrom][this->meanDimensions - 1];
+            float differenceX = superpixelMean[this->meanDimensions - 2]/pixels - pixelMean[this->meanDimensions - 2];
+            float differenceY = superpixelMean[this->meanDimensions - 1]/pixels - pixelMean[this->meanDimensions - 1];
             float currentSpatialScore = (differenceX*differenceX + differenceY*differenceY)/this->spatialNormalization;
 
             #ifdef DEBUG
@@ -1225,17 +1384,20 @@ protected:
      * @return 
      */
     virtual inline float scoreProposedPixelSegmentation(int iFrom, int jFrom, int iSuperpixelTo, int jSuperpixelTo) {
+        const float* pixelMean = this->pixelMeanAt(iFrom, jFrom);
+        const float* superpixelMean = this->superpixelMeanAt(iSuperpixelTo, jSuperpixelTo);
+        float pixels = this->pixelsAt(this->numberOfLevels - 1, iSuperpixelTo, jSuperpixelTo);
         float proposedColorScore = 0.;
 
         if (this->histogramDimensions == 1) {
-            float difference = this->means[1][iSuperpixelTo][jSuperpixelTo][0]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] - this->means[0][iFrom][jFrom][0];
+            float difference = superpixelMean[0]/pixels - pixelMean[0];
 
             proposedColorScore = difference*difference/this->colorNormalization;
         }
         else {
-            float differenceL = this->means[1][iSuperpixelTo][jSuperpixelTo][0]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] - this->means[0][iFrom][jFrom][0];
-            float differenceA = this->means[1][iSuperpixelTo][jSuperpixelTo][1]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] - this->means[0][iFrom][jFrom][1];
-            float differenceB = this->means[1][iSuperpixelTo][jSuperpixelTo][2]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] - this->means[0][iFrom][jFrom][2];
+            float differenceL = superpixelMean[0]/pixels - pixelMean[0];
+            float differenceA = superpixelMean[1]/pixels - pixelMean[1];
+            float differenceB = superpixelMean[2]/pixels - pixelMean[2];
 
             proposedColorScore = (differenceL*differenceL + differenceA*differenceA + differenceB*differenceB)/this->colorNormalization;
         }
@@ -1245,8 +1407,8 @@ protected:
         #endif
 
         if (this->spatialWeight > 0) {
-            float differenceX = this->means[1][iSuperpixelTo][jSuperpixelTo][this->meanDimensions - 2]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] - this->means[0][iFrom][jFrom][this->meanDimensions - 2];
-            float differenceY = this->means[1][iSuperpixelTo][jSuperpixelTo][this->meanDimensions - 1]/this->pixels[this->numberOfLevels - 1][iSuperpixelTo][jSuperpixelTo] - this->means[0][iFrom][jFrom][this->meanDimensions - 1];
+            float differenceX = superpixelMean[this->meanDimensions - 2]/pixels - pixelMean[this->meanDimensions - 2];
+            float differenceY = superpixelMean[this->meanDimensions - 1]/pixels - pixelMean[this->meanDimensions - 1];
             float proposedSpatialScore = (differenceX*differenceX + differenceY*differenceY)/this->spatialNormalization;
 
             #ifdef DEBUG
@@ -1304,8 +1466,34 @@ protected:
         return currentScore - proposedScore;
     }
 
+    /**
+     * Get the feature vector of pixel (i, j).
+     * 
+     * @param int i
+     * @param int j
+     * @return
+     */
+    inline float* pixelMeanAt(int i, int j) const {
+        return (float*) this->pixelMeans.data + (size_t) (i*this->width + j)*this->meanDimensions;
+    }
+
+    /**
+     * Get the accumulated feature vector of superpixel (i, j).
+     * 
+     * @param int i
+     * @param int j
+     * @return
+     */
+    inline float* superpixelMeanAt(int i, int j) const {
+        return (float*) this->superpixelMeans.data + (i*this->superpixelWidthNumber + j)*this->meanDimensions;
+    }
+
     int meanDimensions;
-    float**** means;
+    /**
+     * Per pixel and per superpixel feature vectors, meanDimensions floats each.
+     */
+    cv::Mat pixelMeans;
+    cv::Mat superpixelMeans;
     bool initializedMeans;
     float colorNormalization;
     float spatialWeight;
@@ -0,0 +1,218 @@
+#include "SuperpixelCache.h"
+#include <cstdio>
+
+using namespace std;
+using namespace cv;
+
+string SuperpixelCache::getFileName(const string& key) const
+{
+	// keys are dataset paths such as "Berkeley\12003"
+	string name = key;
+	for (auto &ch : name)
+	{
+		if (ch == '\\' || ch == '/' || ch == ':')
+		{
+			ch = '_';
+		}
+	}
+	return directory + name + ".superpixel.yml.gz";
+}
+
+bool SuperpixelCache::load(const string& key, SuperpixelData& data) const
+{
+	FileStorage fs(getFileName(key), FileStorage::READ);
+	if (!fs.isOpened())
+	{
+		return false;
+	}
+
+	// files written before the hash was stored can not be trusted
+	string hash;
+	fs["imageHash"] >> hash;
+	if (hash.empty())
+	{
+		return false;
+	}
+	data.imageHash = stoull(hash, nullptr, 16);
+
+	int parallel = 0;
+	fs["superpixels"] >> data.params.superpixels;
+	fs["numberOfBins"] >> data.params.numberOfBins;
+	fs["neighborhoodSize"] >> data.params.neighborhoodSize;
+	fs["minimumConfidence"] >> data.params.minimumConfidence;
+	fs["spatialWeight"] >> data.params.spatialWeight;
+	fs["iterations"] >> data.params.iterations;
+	fs["minimumChangeFraction"] >> data.params.minimumChangeFraction;
+	fs["parallel"] >> parallel;
+	data.params.parallel = (parallel != 0);
+
+	Mat centersMat, edgesMat, diffsMat;
+	fs["n"] >> data.n;
+	fs["markers"] >> data.markers;
+	fs["centers"] >> centersMat;
+	fs["edges"] >> edgesMat;
+	fs["colorDiffs"] >> diffsMat;
+
+	if (data.markers.empty() || centersMat.rows != data.n
+		|| (!edgesMat.empty() && edgesMat.cols != 3) || diffsMat.rows != edgesMat.rows)
+	{
+		return false;
+	}
+
+	data.centers.resize(data.n);
+	for (int i = 0; i < data.n; i++)
+	{
+		data.centers[i] = centersMat.at<Vec3f>(i, 0);
+	}
+
+	// edges are stored once as (from, to, boundary) rows with their colour difference
+	data.adjacency.assign(data.n, vector<RegionEdge>());
+	for (int i = 0; i < edgesMat.rows; i++)
+	{
+		const int* e = edgesMat.ptr<int>(i);
+		if (e[0] < 0 || e[0] >= data.n || e[1] < 0 || e[1] >= data.n)
+		{
+			return false;
+		}
+
+		float colorDiff = diffsMat.at<float>(i, 0);
+		data.adjacency[e[0]].push_back({ e[1], e[2], colorDiff });
+		data.adjacency[e[1]].push_back({ e[0], e[2], colorDiff });
+	}
+
+	return true;
+}
+
+void SuperpixelCache::save(const string& key, const SuperpixelData& data) const
+{
+	FileStorage fs(getFileName(key), FileStorage::WRITE);
+	if (!fs.isOpened())
+	{
+		return;
+	}
+
+	Mat centersMat(data.n, 1, CV_32FC3);
+	for (int i = 0; i < data.n; i++)
+	{
+		centersMat.at<Vec3f>(i, 0) = data.centers[i];
+	}
+
+	int edgeCount = 0;
+	for (auto &edges : data.adjacency)
+	{
+		edgeCount += (int)edges.size();
+	}
+
+	Mat edgesMat(edgeCount / 2, 3, CV_32S);
+	Mat diffsMat(edgeCount / 2, 1, CV_32F);
+	int row = 0;
+	for (int i = 0; i < (int)data.adjacency.size(); i++)
+	{
+		for (auto &edge : data.adjacency[i])
+		{
+			if (edge.to > i)
+			{
+				int* e = edgesMat.ptr<int>(row);
+				e[0] = i;
+				e[1] = edge.to;
+				e[2] = edge.boundary;
+				diffsMat.at<float>(row++, 0) = edge.colorDiff;
+			}
+		}
+	}
+
+	// FileStorage has no 64-bit integers
+	char hash[17];
+	snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)data.imageHash);
+	fs << "imageHash" << string(hash);
+
+	fs << "superpixels" << data.params.superpixels;
+	fs << "numberOfBins" << data.params.numberOfBins;
+	fs << "neighborhoodSize" << data.params.neighborhoodSize;
+	fs << "minimumConfidence" << data.params.minimumConfidence;
+	fs << "spatialWeight" << data.params.spatialWeight;
+	fs << "iterations" << data.params.iterations;
+	fs << "minimumChangeFraction" << data.params.minimumChangeFraction;
+	fs << "parallel" << (int)data.params.parallel;
+
+	fs << "n" << data.n;
+	fs << "markers" << data.markers;
+	fs << "centers" << centersMat;
+	fs << "edges" << edgesMat;
+	fs << "colorDiffs" << diffsMat;
+}
+
+bool SuperpixelCache::sameParams(const SuperpixelParams& a, const SuperpixelParams& b)
+{
+	return a.superpixels == b.superpixels
+		&& a.numberOfBins == b.numberOfBins
+		&& a.neighborhoodSize == b.neighborhoodSize
+		&& a.minimumConfidence == b.minimumConfidence
+		&& a.spatialWeight == b.spatialWeight
+		&& a.iterations == b.iterations
+		&& a.minimumChangeFraction == b.minimumChangeFraction
+		&& a.parallel == b.parallel;
+}
+
+uint64_t SuperpixelCache::hashImage(const Mat& image)
+{
+	const uint64_t prime = 1099511628211ULL;
+	uint64_t hash = 14695981039346656037ULL;
+
+	int header[3] = { image.rows, image.cols, image.type() };
+	const uchar* bytes = reinterpret_cast<const uchar*>(header);
+	for (size_t i = 0; i < sizeof(header); i++)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	size_t rowBytes = image.cols * image.elemSize();
+	for (int i = 0; i < image.rows; i++)
+	{
+		const uchar* row = image.ptr<uchar>(i);
+		for (size_t j = 0; j < rowBytes; j++)
+		{
+			hash = (hash ^ row[j]) * prime;
+		}
+	}
+
+	return hash;
+}
+
+bool SuperpixelCache::find(const string& key, const Mat& image, const SuperpixelParams& params, SuperpixelData& data)
+{
+	auto it = entries.find(key);
+	if (it == entries.end())
+	{
+		SuperpixelData loaded;
+		if (directory.empty() || !load(key, loaded))
+		{
+			return false;
+		}
+		it = entries.insert(make_pair(key, loaded)).first;
+	}
+
+	// a different image under the same key, or a run with other params
+	if (it->second.markers.size() != image.size()
+		|| it->second.imageHash != hashImage(image)
+		|| !sameParams(it->second.params, params))
+	{
+		entries.erase(it);
+		return false;
+	}
+
+	data = it->second;
+	return true;
+}
+
+void SuperpixelCache::store(const string& key, const Mat& image, const SuperpixelParams& params, SuperpixelData data)
+{
+	data.imageHash = hashImage(image);
+	data.params = params;
+	entries[key] = data;
+
+	if (!directory.empty())
+	{
+		save(key, data);
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef SUPERPIXEL_CACHE_H
+#define SUPERPIXEL_CACHE_H
+
+#include <opencv2\opencv.hpp>
+#include "SuperpixelTuner.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// One side of a boundary between two adjacent regions
+struct RegionEdge
+{
+	int to;
+
+	// number of 4-connected pixel pairs across the boundary
+	int boundary;
+
+	// distance between the mean colours of both regions
+	float colorDiff;
+};
+
+typedef std::vector< std::vector< RegionEdge > > RegionAdjacency;
+
+// Everything LazySnapping derives from the image alone, before any seed is known
+struct SuperpixelData
+{
+	// pre-segmentation component number
+	int n;
+
+	// region label per pixel, CV_32S
+	cv::Mat markers;
+
+	// mean colour per region
+	std::vector< cv::Vec3f > centers;
+
+	// region adjacency lists, each edge is stored on both regions
+	RegionAdjacency adjacency;
+
+	// hash of the source pixels, tells apart images stored under one key
+	uint64_t imageHash;
+
+	// params the pre-segmentation was computed with
+	SuperpixelParams params;
+};
+
+// Keeps the superpixel pre-segmentation of each image in memory and,
+// when a directory is set, on disk so that later runs can skip SEEDS.
+class SuperpixelCache
+{
+private:
+	std::map< std::string, SuperpixelData > entries;
+
+	std::string directory;
+
+	std::string getFileName(const std::string& key) const;
+
+	bool load(const std::string& key, SuperpixelData& data) const;
+
+	void save(const std::string& key, const SuperpixelData& data) const;
+
+	static bool sameParams(const SuperpixelParams& a, const SuperpixelParams& b);
+
+public:
+	SuperpixelCache() = default;
+	~SuperpixelCache() = default;
+
+	// Empty directory keeps the cache in memory only
+	void setDirectory(const std::string& dir) { directory = dir; }
+
+	// Only hits an entry computed from the same pixels with the same params
+	bool find(const std::string& key, const cv::Mat& image, const SuperpixelParams& params, SuperpixelData& data);
+
+	// Fills in the image hash and params of data before keeping it
+	void store(const std::string& key, const cv::Mat& image, const SuperpixelParams& params, SuperpixelData data);
+
+	// FNV-1a over the size, type and pixel bytes of image
+	static uint64_t hashImage(const cv::Mat& image);
+
+	void clear() { entries.clear(); }
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "SuperpixelTuner.h"
+#include <algorithm>
+
+using namespace std;
+using namespace cv;
+
+// The defaults were chosen for the 481x321 Berkeley images
+const double REFERENCE_PIXELS = 481.0 * 321.0;
+
+const int MIN_SUPERPIXELS = 64;
+const int MAX_SUPERPIXELS = 4096;
+const int MIN_ITERATIONS = 2;
+
+// Cost per pixel and iteration until the first run has been timed
+const double DEFAULT_UNIT_COST = 5e-8;
+
+// Weight of the newest sample in the running average
+const double SAMPLE_WEIGHT = 0.3;
+
+SuperpixelTuner::SuperpixelTuner()
+{
+	latencyBudget = 0;
+	unitCost = DEFAULT_UNIT_COST;
+	samples = 0;
+}
+
+int SuperpixelTuner::getSuperpixels(const Size& imageSize) const
+{
+	// Growing with the square root keeps the boundary detail of large images
+	// without the region graph growing as fast as the pixel count
+	double scale = sqrt((double)imageSize.area() / REFERENCE_PIXELS);
+	int superpixels = (int)(base.superpixels * scale + 0.5);
+	return min(max(superpixels, MIN_SUPERPIXELS), MAX_SUPERPIXELS);
+}
+
+int SuperpixelTuner::getIterations(const Size& imageSize) const
+{
+	if (latencyBudget <= 0 || imageSize.area() == 0)
+	{
+		return base.iterations;
+	}
+
+	// estimate() counts histogram set-up as one more iteration
+	int iterations = (int)(latencyBudget / (unitCost * imageSize.area())) - 1;
+	return min(max(iterations, MIN_ITERATIONS), base.iterations);
+}
+
+SuperpixelParams SuperpixelTuner::tune(const Size& imageSize) const
+{
+	SuperpixelParams params = base;
+	params.superpixels = getSuperpixels(imageSize);
+	params.iterations = getIterations(imageSize);
+	return params;
+}
+
+double SuperpixelTuner::estimate(const Size& imageSize, const SuperpixelParams& params) const
+{
+	return unitCost * imageSize.area() * (params.iterations + 1);
+}
+
+void SuperpixelTuner::addSample(const Size& imageSize, const SuperpixelParams& params, double seconds)
+{
+	double work = (double)imageSize.area() * (params.iterations + 1);
+	if (work <= 0 || seconds <= 0)
+	{
+		return;
+	}
+
+	double cost = seconds / work;
+	unitCost = (samples == 0 ? cost : (1 - SAMPLE_WEIGHT) * unitCost + SAMPLE_WEIGHT * cost);
+	samples++;
+}
+
+bool SuperpixelTuner::load(const string& fileName)
+{
+	FileStorage fs(fileName, FileStorage::READ);
+	if (!fs.isOpened())
+	{
+		return false;
+	}
+
+	double cost = 0;
+	int count = 0;
+	fs["unitCost"] >> cost;
+	fs["samples"] >> count;
+	if (cost <= 0 || count <= 0)
+	{
+		return false;
+	}
+
+	unitCost = cost;
+	samples = count;
+	return true;
+}
+
+void SuperpixelTuner::save(const string& fileName) const
+{
+	FileStorage fs(fileName, FileStorage::WRITE);
+	if (!fs.isOpened())
+	{
+		return;
+	}
+
+	fs << "unitCost" << unitCost;
+	fs << "samples" << samples;
+}
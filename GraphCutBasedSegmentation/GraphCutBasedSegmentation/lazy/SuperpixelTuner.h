@@ -0,0 +1,80 @@
+#ifndef SUPERPIXEL_TUNER_H
+#define SUPERPIXEL_TUNER_H
+
+#include <opencv2\opencv.hpp>
+#include <string>
+
+// Settings of the SEEDS pre-segmentation
+struct SuperpixelParams
+{
+	// number of desired superpixels
+	int superpixels = 300;
+
+	// bins per channel of the colour histograms
+	int numberOfBins = 10;
+
+	// neighbourhood of the smoothing term, >1 is much slower
+	int neighborhoodSize = 1;
+
+	// minimum difference of histogram intersection needed for block updates
+	float minimumConfidence = 0.1f;
+
+	// (1 - spatialWeight)*colorDifference + spatialWeight*spatialDifference,
+	// higher values give more compact superpixels
+	float spatialWeight = 0.25f;
+
+	// block update rounds per level, twice as many pixel update rounds
+	int iterations = 20;
+
+	// pixel updates stop once a round moves fewer pixels than this fraction,
+	// 0 only skips rounds that move nothing and keeps the serial result
+	float minimumChangeFraction = 0.0f;
+
+	// checkerboard pixel updates across all cores, the superpixels differ
+	// slightly from the serial sweep
+	bool parallel = false;
+};
+
+// Chooses the superpixel count from the image resolution and the number of
+// iterations from a latency budget, using the cost per pixel and iteration
+// measured on earlier runs.
+class SuperpixelTuner
+{
+private:
+	// everything the tuner does not choose
+	SuperpixelParams base;
+
+	// seconds allowed for one pre-segmentation, 0 for no limit
+	double latencyBudget;
+
+	// seconds per pixel and iteration, running average over the samples
+	double unitCost;
+	int samples;
+
+	int getSuperpixels(const cv::Size& imageSize) const;
+
+	int getIterations(const cv::Size& imageSize) const;
+
+public:
+	SuperpixelTuner();
+	~SuperpixelTuner() = default;
+
+	void setBaseParams(const SuperpixelParams& params) { base = params; }
+
+	void setLatencyBudget(double seconds) { latencyBudget = seconds; }
+
+	SuperpixelParams tune(const cv::Size& imageSize) const;
+
+	// Time of a pre-segmentation run with params
+	void addSample(const cv::Size& imageSize, const SuperpixelParams& params, double seconds);
+
+	// Predicted seconds for params on an image of imageSize
+	double estimate(const cv::Size& imageSize, const SuperpixelParams& params) const;
+
+	// Timing history of earlier processes
+	bool load(const std::string& fileName);
+
+	void save(const std::string& fileName) const;
+};
+
+#endif
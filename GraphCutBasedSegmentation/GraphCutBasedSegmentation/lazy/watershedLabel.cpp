@@ -9,75 +9,93 @@
 using namespace cv;
 using namespace std;
 
-const int MaxR = 2000;
-const int MaxC = 2000;
-
 Mat Watershed::getMarkersLabel()
 {
 	cv::Mat image = src;
 
-	// Number of desired superpixels.
-	int superpixels = 300;
-
-	// Number of bins for color histograms (per channel).
-	int numberOfBins = 10;
-
-	// Size of neighborhood used for smoothing term, see [1] or [2].
-	// 1 will be sufficient, >1 will slow down the algorithm.
-	int neighborhoodSize = 1;
+	SuperpixelParams run = getParamsFor(image.size());
 
-	// Minimum confidence, that is minimum difference of histogram intersection
-	// needed for block updates: 0.1 is the default value.
-	float minimumConfidence = 0.1;
-
-	// The weighting of spatial smoothing for mean pixel updates - the euclidean
-	// distance between pixel coordinates and mean superpixel coordinates is used
-	// and weighted according to:
-	//  (1 - spatialWeight)*colorDifference + spatialWeight*spatialDifference
-	// The higher spatialWeight, the more compact superpixels are generated.
-	float spatialWeight = 0.25;
+	int64 start = getTickCount();
 
 	// Instantiate a new object for the given image.
-	SEEDSRevisedMeanPixels seeds(image, superpixels, numberOfBins, neighborhoodSize, minimumConfidence, spatialWeight);
+	SEEDSRevisedMeanPixels seeds(image, run.superpixels, run.numberOfBins, run.neighborhoodSize, run.minimumConfidence, run.spatialWeight);
+
+	// Pixel updates on a checkerboard schedule across all cores, stopping
+	// once an iteration moves less than the given fraction of the pixels.
+	seeds.setParallel(run.parallel);
+	seeds.setMinimumChangeFraction(run.minimumChangeFraction);
 
-	int iterations = 20;
 	// Initializes histograms and labels.
 	seeds.initialize();
 	// Runs a given number of block updates and pixel updates.
-	seeds.iterate(iterations);
-
-	// Save a contour image to the following location:
-	std::string storeContours = "./contours.png";
+	seeds.iterate(run.iterations);
 
-	// bgr color for contours:
-	int bgr[] = { 0, 0, 204 };
+	if (tuner)
+	{
+		tuner->addSample(image.size(), run, double(getTickCount() - start) / getTickFrequency());
+	}
 
-	// seeds.getLabels() returns a two-dimensional array containing the computed
-	// superpixel labels.
-	cv::Mat contourImage = Draw::contourImage(seeds.getLabels(), image, bgr);
-	imwrite(storeContours, contourImage);
-	imshow("Contours", contourImage);
+	lastParams = run;
 
-	int** labels = seeds.getLabels();
+	// The label buffer is shared, not copied
+	markers = seeds.getLabelsMat();
 
-	//cv::Mat labelImage = Draw::labelImage(labels, src);
+	if (diagnostics)
+	{
+		dumpContours(markers);
+	}
 
-	//imwrite("LabelsImage.bmp", labelImage);
-	//imshow("LabelsImage.bmp", labelImage);
+	return markers;
+}
 
-	//cv::Mat meanImage = Draw::meanImage(labels, src);
-	//imwrite("MeanImage.bmp", meanImage);
-	//imshow("MeanImage.bmp", meanImage);
+Watershed::~Watershed()
+{
+	waitForDiagnostics();
+}
 
-	markers = Mat::zeros(src.rows, src.cols, CV_32S);
+void Watershed::waitForDiagnostics()
+{
+	if (pendingDump.valid())
+	{
+		pendingDump.get();
+	}
+}
 
-	for (int i = 0; i < markers.rows; i++) {
-		for (int j = 0; j < markers.cols; j++)
+string Watershed::getDebugFileName() const
+{
+	string name = debugName;
+	for (auto &ch : name)
+	{
+		if (ch == '\\' || ch == '/' || ch == ':')
 		{
-			markers.at<int>(i, j) = labels[i][j];
+			ch = '_';
 		}
-			
 	}
+	return debugDirectory + name + "_contours.png";
+}
 
-	return markers;
+void Watershed::dumpContours(const Mat& labels)
+{
+	// One dump in flight at a time, a slow disk must not pile up threads
+	waitForDiagnostics();
+
+	// The caller keeps working on its labels and image, so the task owns copies
+	Mat image = src.clone();
+	Mat labelCopy = labels.clone();
+	string fileName = getDebugFileName();
+
+	pendingDump = async(launch::async, [image, labelCopy, fileName]()
+	{
+		vector<int*> rows(labelCopy.rows);
+		for (int i = 0; i < labelCopy.rows; i++)
+		{
+			rows[i] = (int*)labelCopy.ptr<int>(i);
+		}
+
+		// bgr color for contours:
+		int bgr[] = { 0, 0, 204 };
+
+		Mat contourImage = Draw::contourImage(rows.data(), image, bgr);
+		imwrite(fileName, contourImage);
+	});
 }
@@ -4,6 +4,9 @@
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/core/utility.hpp>
+#include "SuperpixelTuner.h"
+#include <future>
+#include <string>
 
 class Watershed
 {
@@ -11,14 +14,53 @@ private:
 	cv::Mat src;
 	cv::Mat markers;
 
+	SuperpixelParams params;
+
+	// params actually used by the last getMarkersLabel()
+	SuperpixelParams lastParams;
+
+	// When set, chooses the params per image and learns from the run time
+	SuperpixelTuner* tuner = nullptr;
+
+	// Debug images are only produced when diagnostics are enabled
+	bool diagnostics = false;
+	std::string debugDirectory;
+	std::string debugName = "superpixels";
+
+	// Contour image still being encoded and written
+	std::future<void> pendingDump;
+
+	std::string getDebugFileName() const;
+
+	void dumpContours(const cv::Mat& labels);
+
 public:
 
 	Watershed() = default;
-	~Watershed() = default;
+	~Watershed();
 
 	void setSourceImage(cv::Mat source) { src = source; }
 	void setMarkers(cv::Mat mark) { markers = mark; }
 
+	void setParams(const SuperpixelParams& superpixelParams) { params = superpixelParams; }
+	const SuperpixelParams& getParams() const { return params; }
+	const SuperpixelParams& getLastParams() const { return lastParams; }
+
+	// params the next getMarkersLabel() will use on an image of imageSize
+	SuperpixelParams getParamsFor(const cv::Size& imageSize) const { return tuner ? tuner->tune(imageSize) : params; }
+
+	void setTuner(SuperpixelTuner* superpixelTuner) { tuner = superpixelTuner; }
+
+	// Write a contour image per call to directory, off the calling thread
+	void setDiagnostics(bool enable, const std::string& directory = "") { diagnostics = enable; debugDirectory = directory; }
+
+	// Prefix of the next debug image, e.g. the image name
+	void setDebugName(const std::string& name) { debugName = name; }
+
+	// Superpixel labels of src, CV_32S
 	cv::Mat getMarkersLabel();
 
-};
\ No newline at end of file
+	// Block until the last debug image is on disk
+	void waitForDiagnostics();
+
+};
@@ -1,9 +1,13 @@
 #include <cstdio>
 #include <cstdlib>
 #include <fstream>
+#include <sstream>
 
 #include "graphcut\GraphCutSegmentation.h"
 #include "lazy\LazySnapping.h"
+#include "hybrid\HybridSegmentation.h"
+#include "benchmark\Benchmark.h"
+#include "benchmark\MaxflowBenchmark.h"
 
 #define LBUTTON_OFF	0
 #define LBUTTON_ON 	1
@@ -20,6 +24,10 @@ std::ofstream ofs("result\\time.csv");
 
 GraphCutSegmentation gc;
 LazySnapping ls;
+HybridSegmentation hs;
+SuperpixelCache spCache;
+SuperpixelTuner spTuner;
+SolverSelector solverSelector;
 
 cv::Mat original_img, type, hint_img;
 std::vector<std::string> inputList;
@@ -34,11 +42,15 @@ void params_init() {
 void argument_disp() {
 
 	printf("Usage:\n");
-	printf("<binary> <mode> <input_file>\n");
+	printf("<binary> <mode> <input_file> [repeats]\n");
 	printf("where:\n");
 	printf("	- binary: the compiled executable file, e.g InteractiveGraphCut.exe\n");
-	printf("	- mode: 0 for only creating hints, 1 for creating hints and segmenting images\n");
-	printf("	- input_file: the file contains the list of input images, generated by GenDataList.ps1\n");
+	printf("	- mode: 0 for only creating hints, 1 for creating hints and segmenting images,\n");
+	printf("	        2 for benchmarking against the stored baseline, 3 for benchmarking and updating the baseline,\n");
+	printf("	        4 for max_flow micro-benchmarks on synthetic grids\n");
+	printf("	- input_file: the file contains the list of input images, generated by GenDataList.ps1,\n");
+	printf("	              or the largest grid size, e.g. 4096x4096, in mode 4\n");
+	printf("	- repeats: number of runs per image in benchmark modes (default 5)\n");
 
 }
 
@@ -207,9 +219,15 @@ void getObj(const std::string& fileName) {
 
 	cv::Mat outMask;
 	gc.createDefault();
+	// One cut per image, no seeds are added afterwards
+	gc.setPersistency(true);
+	// Small objects on a large canvas: solve around the object seeds only
+	//gc.setRoiMargin(32);
+	//gc.setSolver(MaxflowSolver::IBFS);
 	start = cv::getTickCount();
 	gc.segment(original_img, type, outMask);
 	end = cv::getTickCount();
+	std::cout << "maxflow solver " << gc.getSolverChoice() << std::endl;
 	gc.cleanGarbage();
 	ofs << double(end - start) / cv::getTickFrequency() << ',';
 
@@ -218,20 +236,33 @@ void getObj(const std::string& fileName) {
 	//cv::imshow("gcObj", obj);
 	cv::imwrite(DST + fileName + "_graphcut_object.jpg", obj, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 90});
 
-	// Measure lazy snapping
-	//ls.setSourceImage(original_img);
-	//ls.setBackgroundPoints(hintBkg);
-	//ls.setForegroundPoints(hintObj);
+	// Measure lazy snapping, the superpixels of an already seen image are reused
+	start = cv::getTickCount();
+	ls.setSourceImage(original_img);
+	ls.setSuperpixelCache(&spCache, fileName);
+	ls.setBackgroundPoints(hintBkg);
+	ls.setForegroundPoints(hintObj);
+	ls.runMaxFlow();
+	end = cv::getTickCount();
 
+	ofs << double(end - start) / cv::getTickFrequency() << ',';
+
+	obj.release();
+	original_img.copyTo(obj, ls.getMask());
+	//cv::imshow("lsObj", obj);
+	cv::imwrite(DST + fileName + "_lazy_object.jpg", obj, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 90});
+
+	// Measure the superpixel cut refined per pixel along its boundary
+	hs.getLazySnapping().setSuperpixelCache(&spCache, fileName);
 	start = cv::getTickCount();
-	//ls.initMarkers();
-	//ls.runMaxFlow();
+	hs.segment(original_img, hintBkg, hintObj, outMask);
 	end = cv::getTickCount();
 
 	ofs << double(end - start) / cv::getTickFrequency() << "\n";
-	//obj = ls.getImageColor();
-	//cv::imshow("lsObj", obj);
-	//cv::imwrite(DST + fileName + "_lazy_object.jpg", obj, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 100});
+
+	obj.release();
+	original_img.copyTo(obj, outMask);
+	cv::imwrite(DST + fileName + "_hybrid_object.jpg", obj, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 90});
 
 	//cv::waitKey(0);
 	//cv::destroyAllWindows();
@@ -242,48 +273,49 @@ void testLambda(const std::string& inputFile) {
 	original_img = cv::imread(inputFile);
 	setHint(tmpFile);
 	const std::vector<float> lambda{ 0.0, 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64 };
-	for (auto lambdaVal : lambda) {
-		
-		type = cv::Mat::zeros(cv::Size(original_img.cols, original_img.rows), CV_8S);
-
-		std::cout << "starting to segment image" << tmpFile << " " << lambdaVal <<  std::endl;
-		std::ifstream hintFile(SRC + tmpFile + ".hint");
-		int nSeed;
-		hintFile >> nSeed;
-		for (int i = 0; i < nSeed; i++) {
-			int x, y;
-			hintFile >> x >> y;
-			type.at<char>(y, x) = GraphCutSegmentation::BACKGROUND;
-		}
-		hintFile >> nSeed;
-		for (int i = 0; i < nSeed; i++) {
-			int x, y;
-			hintFile >> x >> y;
-			type.at<char>(y, x) = GraphCutSegmentation::OBJECT;
-		}
 
-		// Measure interactive graphcut
-		uint64_t start, end;
+	// Every lambda cuts the same image, convert it only once
+	FeaturePlanes planes;
+	planes.compute(original_img);
+
+	type = cv::Mat::zeros(cv::Size(original_img.cols, original_img.rows), CV_8S);
+
+	std::cout << "starting to segment image" << tmpFile << std::endl;
+	std::ifstream hintFile(SRC + tmpFile + ".hint");
+	int nSeed;
+	hintFile >> nSeed;
+	for (int i = 0; i < nSeed; i++) {
+		int x, y;
+		hintFile >> x >> y;
+		type.at<char>(y, x) = GraphCutSegmentation::BACKGROUND;
+	}
+	hintFile >> nSeed;
+	for (int i = 0; i < nSeed; i++) {
+		int x, y;
+		hintFile >> x >> y;
+		type.at<char>(y, x) = GraphCutSegmentation::OBJECT;
+	}
+
+	// Measure the whole sweep, every lambda reuses the same graph
+	uint64_t start, end;
 
-		cv::Mat outMask;
-		gc.createDefault();
-		gc.setRegionBoundaryRelation(lambdaVal);
-		start = cv::getTickCount();
-		gc.segment(original_img, type, outMask);
-		end = cv::getTickCount();
-		gc.cleanGarbage();
-		ofs << double(end - start) / cv::getTickFrequency() << ',';
+	std::vector<cv::Mat> outMasks;
+	gc.createDefault();
+	start = cv::getTickCount();
+	gc.segmentLambdas(planes, type, lambda, outMasks);
+	end = cv::getTickCount();
+	gc.cleanGarbage();
+	ofs << double(end - start) / cv::getTickFrequency() << ',';
 
+	for (size_t k = 0; k < lambda.size(); k++) {
 		cv::Mat obj;
-		original_img.copyTo(obj, outMask);
+		original_img.copyTo(obj, outMasks[k]);
 		//cv::imshow("gcObj", obj);
-		cv::imwrite(DST + tmpFile + "_graphcut_object" + std::to_string(lambdaVal) + ".jpg", obj, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 100});
+		cv::imwrite(DST + tmpFile + "_graphcut_object" + std::to_string(lambda[k]) + ".jpg", obj, std::vector<int>{CV_IMWRITE_JPEG_QUALITY, 100});
 	}
 }
 
-void readInputFile(const std::string& inputFile) {
-
-	ofs << "Test,InteractiveGraphCut,LazySnapping\r\n";
+void loadInputList(const std::string& inputFile) {
 
 	std::ifstream ifs(inputFile);
 	if (!ifs.good()) {
@@ -298,6 +330,29 @@ void readInputFile(const std::string& inputFile) {
 		tmpFile = tmpFile.substr(0, tmpFile.find_last_of('.'));
 		inputList.push_back(tmpFile);
 	}
+
+}
+
+void readInputFile(const std::string& inputFile) {
+
+	ofs << "Test,InteractiveGraphCut,LazySnapping,Hybrid\r\n";
+
+	loadInputList(inputFile);
+
+	// Pre-segmentations survive between batch runs on the same dataset
+	spCache.setDirectory(DST);
+	//ls.setDiagnostics(true, DST);
+
+	// Superpixel count follows the image size, the iterations a latency budget
+	// learnt from the timing of earlier runs
+	spTuner.load(DST "superpixel_timing.yml");
+	//spTuner.setLatencyBudget(0.5);
+	ls.setSuperpixelTuner(&spTuner);
+
+	// Max-flow backend picked per image from the timing of earlier runs,
+	// setSolver() on gc forces one
+	solverSelector.load(DST "solver_timing.yml");
+	gc.setSolverSelector(&solverSelector);
 		
 	for (auto &file : inputList)
 		setHint(file);
@@ -305,9 +360,64 @@ void readInputFile(const std::string& inputFile) {
 	for (auto &file : inputList)
 		getObj(file);
 
+	spTuner.save(DST "superpixel_timing.yml");
+	solverSelector.save(DST "solver_timing.yml");
+
+}
+
+int runBenchmark(const std::string& inputFile, int repeats, bool updateBaseline) {
+
+	loadInputList(inputFile);
+
+	Benchmark bench(SRC, DST);
+	bench.setRepeats(repeats);
+	bench.setUpdateBaseline(updateBaseline);
+	return bench.run(inputList);
+
 }
 
-void switchMode(int mode, const std::string& inputFile) {
+int runMaxflowBenchmark(const std::string& gridSize, int repeats) {
+
+	int maxWidth = 0, maxHeight = 0;
+	if (sscanf(gridSize.c_str(), "%dx%d", &maxWidth, &maxHeight) != 2) {
+		argument_disp();
+		exit(1);
+	}
+
+	MaxflowBenchmark bench;
+	bench.setRepeats(repeats);
+
+	std::ofstream csv(DST "maxflow_benchmark.csv");
+	MaxflowBenchmark::writeHeader(csv);
+	MaxflowBenchmark::writeHeader(std::cout);
+
+	// Double the pixel count per step to show the scaling curve
+	int failures = 0;
+	for (double scale = 1.0 / 64; scale <= 1.0 + 1e-9; scale *= 2) {
+		int width = std::max(16, int(maxWidth * std::sqrt(scale)));
+		int height = std::max(16, int(maxHeight * std::sqrt(scale)));
+
+		for (int p = GridGenerator::NOISE; p <= GridGenerator::THIN; p++) {
+			GridGenerator gen(width, height, GridGenerator::Pattern(p));
+
+			// Scattered flips for the usual timing, blocks to check marked neighbours
+			for (int f = MaxflowBenchmark::STRIDE; f <= MaxflowBenchmark::CLUSTERED; f++) {
+				std::stringstream row;
+				bench.setFlipPattern(MaxflowBenchmark::FlipPattern(f));
+				failures += bench.run(gen, row);
+				csv << row.str();
+				std::cout << row.str();
+			}
+		}
+	}
+
+	if (failures > 0)
+		std::cout << failures << " re-solves differ from a fresh solve\n";
+	return failures;
+
+}
+
+void switchMode(int mode, const std::string& inputFile, int repeats = 5) {
 	params_init();
 	switch (mode) {
 	case 0:
@@ -316,6 +426,15 @@ void switchMode(int mode, const std::string& inputFile) {
 	case 1:
 		readInputFile(inputFile);
 		break;
+	case 2:
+	case 3:
+		if (runBenchmark(inputFile, repeats, mode == 3) > 0)
+			exit(2);
+		break;
+	case 4:
+		if (runMaxflowBenchmark(inputFile, repeats) > 0)
+			exit(2);
+		break;
 
 	default:
 		argument_disp();
@@ -328,6 +447,9 @@ int main(int argc, char** argv) {
 	case 3:
 		switchMode(std::stoi(argv[1]), argv[2]);
 		break;
+	case 4:
+		switchMode(std::stoi(argv[1]), argv[2], std::stoi(argv[3]));
+		break;
 	default:
 		argument_disp();
 	}
@@ -0,0 +1,66 @@
+#include "MaxflowSolver.h"
+#include "graph.h"
+#include "ibfs.h"
+
+namespace {
+
+	// Both graphs share the BK interface, only the type differs
+	template <typename GraphType>
+	class SolverAdapter : public MaxflowSolver {
+
+	public:
+
+		SolverAdapter(int nodeNumMax, int edgeNumMax) : graph(nodeNumMax, edgeNumMax) {}
+
+		int add_node(int num) { return graph.add_node(num); }
+
+		void add_edge(int i, int j, double cap, double rev_cap) { graph.add_edge(i, j, cap, rev_cap); }
+
+		void add_tweights(int i, double cap_source, double cap_sink) { graph.add_tweights(i, cap_source, cap_sink); }
+
+		double maxflow(bool reuse_trees) { return graph.maxflow(reuse_trees); }
+
+		termtype what_segment(int i, termtype default_segm) {
+			typename GraphType::termtype segm = (default_segm == SINK ? GraphType::SINK : GraphType::SOURCE);
+			return graph.what_segment(i, segm) == GraphType::SINK ? SINK : SOURCE;
+		}
+
+		void mark_node(int i) { graph.mark_node(i); }
+
+		void set_interrupt(const std::atomic<bool>* cancel, double time_budget) { graph.set_interrupt(cancel, time_budget); }
+
+		bool is_optimal() { return graph.is_optimal(); }
+
+		void reset() { graph.reset(); }
+
+	private:
+
+		GraphType	graph;
+
+	};
+
+}
+
+MaxflowSolver* MaxflowSolver::create(Algorithm algorithm, int nodeNumMax, int edgeNumMax) {
+
+	switch (algorithm) {
+	case IBFS:
+		return new SolverAdapter< IBFSGraph<double, double, double> >(nodeNumMax, edgeNumMax);
+	default:
+		return new SolverAdapter< Graph<double, double, double> >(nodeNumMax, edgeNumMax);
+	}
+
+}
+
+const char* MaxflowSolver::algorithmName(Algorithm algorithm) {
+
+	switch (algorithm) {
+	case IBFS:
+		return "ibfs";
+	case AUTO:
+		return "auto";
+	default:
+		return "bk";
+	}
+
+}
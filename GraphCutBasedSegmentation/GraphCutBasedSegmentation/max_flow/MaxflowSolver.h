@@ -0,0 +1,53 @@
+#ifndef MAXFLOW_SOLVER_H_
+#define MAXFLOW_SOLVER_H_
+
+#include <atomic>
+
+// Max-flow backend chosen at runtime. Wraps Graph (Boykov-Kolmogorov) or
+// IBFSGraph with double capacities behind the part of the Graph interface
+// the segmentation uses; what_segment() has the same meaning for both.
+class MaxflowSolver {
+
+public:
+
+	// AUTO is resolved by the caller, create() treats it as BK
+	enum Algorithm {
+		BK,
+		IBFS,
+		AUTO
+	};
+
+	typedef enum {
+		SOURCE = 0,
+		SINK = 1
+	} termtype;
+
+	virtual ~MaxflowSolver() {}
+
+	virtual int add_node(int num = 1) = 0;
+
+	virtual void add_edge(int i, int j, double cap, double rev_cap) = 0;
+
+	virtual void add_tweights(int i, double cap_source, double cap_sink) = 0;
+
+	virtual double maxflow(bool reuse_trees = false) = 0;
+
+	virtual termtype what_segment(int i, termtype default_segm = SOURCE) = 0;
+
+	virtual void mark_node(int i) = 0;
+
+	// Stop the following maxflow() calls early, see Graph::set_interrupt()
+	virtual void set_interrupt(const std::atomic<bool>* cancel, double time_budget) = 0;
+
+	// false if the last maxflow() stopped before the flow was maximum
+	virtual bool is_optimal() = 0;
+
+	virtual void reset() = 0;
+
+	static MaxflowSolver* create(Algorithm algorithm, int nodeNumMax, int edgeNumMax);
+
+	static const char* algorithmName(Algorithm algorithm);
+
+};
+
+#endif /* MAXFLOW_SOLVER_H_ */
@@ -10,7 +10,6 @@
 template <typename captype, typename tcaptype, typename flowtype> 
 	Graph<captype, tcaptype, flowtype>::Graph(int node_num_max, int edge_num_max, void (*err_function)(char *))
 	: node_num(0),
-	  nodeptr_block(NULL),
 	  error_function(err_function)
 {
 	if (node_num_max < 16) node_num_max = 16;
@@ -27,16 +26,16 @@ template <typename captype, typename tcaptype, typename flowtype>
 
 	maxflow_iteration = 0;
 	flow = 0;
+
+	cancel = NULL;
+	time_budget = 0;
+	interrupted = false;
+	resume_first = resume_last = NULL;
 }
 
 template <typename captype, typename tcaptype, typename flowtype> 
 	Graph<captype,tcaptype,flowtype>::~Graph()
 {
-	if (nodeptr_block) 
-	{ 
-		delete nodeptr_block; 
-		nodeptr_block = NULL; 
-	}
 	free(nodes);
 	free(arcs);
 }
@@ -48,14 +47,17 @@ template <typename captype, typename tcaptype, typename flowtype>
 	arc_last = arcs;
 	node_num = 0;
 
-	if (nodeptr_block) 
-	{ 
-		delete nodeptr_block; 
-		nodeptr_block = NULL; 
-	}
-
 	maxflow_iteration = 0;
 	flow = 0;
+	interrupted = false;
+	resume_first = resume_last = NULL;
+}
+
+template <typename captype, typename tcaptype, typename flowtype> 
+	void Graph<captype,tcaptype,flowtype>::set_interrupt(const std::atomic<bool>* _cancel, double _time_budget)
+{
+	cancel = _cancel;
+	time_budget = _time_budget;
 }
 
 template <typename captype, typename tcaptype, typename flowtype> 
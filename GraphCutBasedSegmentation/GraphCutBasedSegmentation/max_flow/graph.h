@@ -43,6 +43,8 @@
 #include "block.h"
 
 #include <assert.h>
+#include <atomic>
+#include <chrono>
 // NOTE: in UNIX you need to use -DNDEBUG preprocessor option to supress assert's!!!
 
 
@@ -114,6 +116,21 @@ public:
 	// to both the source and the sink, then default_segm is returned.
 	termtype what_segment(node_id i, termtype default_segm = SOURCE);
 
+	// Makes the following maxflow() calls stop early once *cancel is set
+	// (it may be set from another thread) or time_budget seconds after
+	// they start. NULL and time_budget <= 0 turn the respective check off.
+	//
+	// An interrupted maxflow() returns the flow found so far and
+	// what_segment() then reports the current search trees: SOURCE and SINK
+	// for nodes in the source and sink tree, default_segm for free nodes.
+	// This is not a minimum cut yet. maxflow(true) continues where the
+	// interrupted call stopped; nodes changed in between are marked with
+	// mark_node() as usual.
+	void set_interrupt(const std::atomic<bool>* cancel, double time_budget = 0);
+
+	// false if the last maxflow() was interrupted before the flow was maximum
+	bool is_optimal() { return !interrupted; }
+
 
 
 	//////////////////////////////////////////////
@@ -266,6 +283,7 @@ private:
 		arc			*parent;	// node's parent
 		node		*next;		// pointer to the next active node
 								//   (or to itself if it is the last node in the list)
+		node		*next_orphan; // pointer to the next orphan, same convention as next
 		int			TS;			// timestamp showing when DIST was computed
 		int			DIST;		// distance to the terminal
 		int			is_sink : 1;	// flag showing whether the node is in the source or in the sink tree (if parent!=NULL)
@@ -286,20 +304,11 @@ private:
 		captype		r_cap;		// residual capacity
 	};
 
-	struct nodeptr
-	{
-		node    	*ptr;
-		nodeptr		*next;
-	};
-	static const int NODEPTR_BLOCK_SIZE = 128;
-
 	node				*nodes, *node_last, *node_max; // node_last = nodes+node_num, node_max = nodes+node_num_max;
 	arc					*arcs, *arc_last, *arc_max; // arc_last = arcs+2*edge_num, arc_max = arcs+2*edge_num_max;
 
 	int					node_num;
 
-	DBlock<nodeptr>		*nodeptr_block;
-
 	void	(*error_function)(char *);	// this function is called if a error occurs,
 										// with a corresponding error message
 										// (or exit(1) is called if it's NULL)
@@ -313,9 +322,17 @@ private:
 	/////////////////////////////////////////////////////////////////////////
 
 	node				*queue_first[2], *queue_last[2];	// list of active nodes
-	nodeptr				*orphan_first, *orphan_last;		// list of pointers to orphans
+	node				*orphan_first, *orphan_last;		// list of orphans, linked through next_orphan
 	int					TIME;								// monotonically increasing global counter
 
+	// stopping maxflow() early, see set_interrupt()
+	const std::atomic<bool>	*cancel;
+	double				time_budget;
+	std::chrono::steady_clock::time_point deadline;
+	int					interrupt_counter;	// main loop iterations since the last check
+	bool				interrupted;
+	node				*resume_first, *resume_last;	// active nodes of an interrupted call, linked through next_orphan
+
 	/////////////////////////////////////////////////////////////////////////
 
 	void reallocate_nodes(int num); // num is the number of new nodes
@@ -328,11 +345,14 @@ private:
 	// functions for processing orphans list
 	void set_orphan_front(node* i); // add to the beginning of the list
 	void set_orphan_rear(node* i);  // add to the end of the list
+	node *next_orphan();            // remove the first node of the list
 
 	void add_to_changed_list(node* i);
 
 	void maxflow_init();             // called if reuse_trees == false
 	void maxflow_reuse_trees_init(); // called if reuse_trees == true
+	bool interrupt_requested();      // polled by the main loop
+	void save_active_nodes(node* current_node); // keeps them for maxflow(true)
 	void augment(arc *middle_arc);
 	void process_source_orphan(node *i);
 	void process_sink_orphan(node *i);
@@ -0,0 +1,437 @@
+/* ibfs.cpp */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include "ibfs.h"
+
+
+template <typename captype, typename tcaptype, typename flowtype>
+	IBFSGraph<captype, tcaptype, flowtype>::IBFSGraph(int node_num_max, int edge_num_max, void (*err_function)(char *))
+	: error_function(err_function)
+{
+	if (node_num_max < 16) node_num_max = 16;
+	if (edge_num_max < 16) edge_num_max = 16;
+
+	nodes.reserve(node_num_max + 1);
+	new_edges.reserve(edge_num_max);
+	interrupt_cancel = NULL;
+	interrupt_budget = 0;
+	reset();
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	IBFSGraph<captype,tcaptype,flowtype>::~IBFSGraph()
+{
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::reset()
+{
+	node n = { 0, NONE, 0, 0, 0 };
+	nodes.assign(1, n);
+	arcs.clear();
+	new_edges.clear();
+	built_node_num = 0;
+
+	flow = 0;
+	interrupted = false;
+}
+
+/***********************************************************************/
+
+/*
+	Groups the arcs by tail so that scanning a node reads one contiguous
+	range. Arcs built earlier keep their residual capacities.
+*/
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::build_arcs()
+{
+	int n = node_num();
+	int a;
+
+	if (new_edges.empty() && built_node_num == n) return;
+
+	for (a=0; a<(int)arcs.size(); a++)
+	if (a < arcs[a].sister)
+	{
+		edge e = { arcs[arcs[a].sister].head, arcs[a].head, arcs[a].r_cap, arcs[arcs[a].sister].r_cap };
+		new_edges.push_back(e);
+	}
+
+	std::vector<int> pos(n + 1, 0);
+	for (size_t k=0; k<new_edges.size(); k++)
+	{
+		pos[new_edges[k].i + 1] ++;
+		pos[new_edges[k].j + 1] ++;
+	}
+	for (int i=0; i<n; i++) pos[i + 1] += pos[i];
+	for (int i=0; i<=n; i++) nodes[i].first = pos[i];
+
+	arcs.resize(2 * new_edges.size());
+	for (size_t k=0; k<new_edges.size(); k++)
+	{
+		const edge& e = new_edges[k];
+		int a_fwd = pos[e.i] ++;
+		int a_rev = pos[e.j] ++;
+
+		arcs[a_fwd].head = e.j;
+		arcs[a_fwd].sister = a_rev;
+		arcs[a_fwd].r_cap = e.cap;
+		arcs[a_rev].head = e.i;
+		arcs[a_rev].sister = a_fwd;
+		arcs[a_rev].r_cap = e.rev_cap;
+	}
+
+	new_edges.clear();
+	built_node_num = n;
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::init_trees()
+{
+	for (int t=0; t<2; t++)
+	{
+		level[t] = 1;
+		active[t].clear();
+		next_active[t].clear();
+		pending[t].clear();
+	}
+	orphans.clear();
+
+	for (int i=0; i<node_num(); i++)
+	{
+		nodes[i].parent = NONE;
+		nodes[i].label = 0;
+		if (nodes[i].tr_cap > 0)      set_label(i, 0, 1, TERMINAL);
+		else if (nodes[i].tr_cap < 0) set_label(i, 1, 1, TERMINAL);
+	}
+}
+
+/***********************************************************************/
+
+/*
+	Puts i into tree t at distance d and queues it for the scan of its level.
+	Nodes that end up below the level being scanned are scanned on their own.
+*/
+template <typename captype, typename tcaptype, typename flowtype>
+	inline void IBFSGraph<captype,tcaptype,flowtype>::set_label(int i, int t, int d, int parent)
+{
+	nodes[i].label = (t == 0) ? d : -d;
+	nodes[i].parent = parent;
+
+	if (d < level[t])       pending[t].push_back(i);
+	else if (d == level[t]) active[t].push_back(i);
+	else                    next_active[t].push_back(i);
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	inline void IBFSGraph<captype,tcaptype,flowtype>::set_orphan(int i)
+{
+	if (nodes[i].parent == ORPHAN) return;
+	nodes[i].parent = ORPHAN;
+	orphans.push_back(i);
+}
+
+/***********************************************************************/
+
+/*
+	Grows tree t from i: free neighbours join one level further, a
+	neighbour in the other tree closes a path which is augmented at once.
+*/
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::scan(int i, int t)
+{
+	int label = nodes[i].label;
+	int d = distance(i);
+
+	for (int a=nodes[i].first; a<nodes[i + 1].first; a++)
+	{
+		while (1)
+		{
+			captype cap = (t == 0) ? arcs[a].r_cap : arcs[arcs[a].sister].r_cap;
+			if (!(cap > 0)) break;
+
+			int j = arcs[a].head;
+			if (nodes[j].label == 0)
+			{
+				set_label(j, t, d + 1, arcs[a].sister);
+				break;
+			}
+			if (tree(j) == t) break;
+
+			augment((t == 0) ? a : arcs[a].sister);
+			adopt();
+
+			/* i may have moved while its tree was repaired */
+			if (nodes[i].label != label) return;
+		}
+	}
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::augment(int middle_arc)
+{
+	int i, a;
+	tcaptype bottleneck;
+
+	/* 1. Finding bottleneck capacity */
+	/* 1a - the source tree */
+	bottleneck = arcs[middle_arc].r_cap;
+	for (i=arcs[arcs[middle_arc].sister].head; ; i=arcs[a].head)
+	{
+		a = nodes[i].parent;
+		if (a == TERMINAL) break;
+		if (bottleneck > arcs[arcs[a].sister].r_cap) bottleneck = arcs[arcs[a].sister].r_cap;
+	}
+	if (bottleneck > nodes[i].tr_cap) bottleneck = nodes[i].tr_cap;
+	/* 1b - the sink tree */
+	for (i=arcs[middle_arc].head; ; i=arcs[a].head)
+	{
+		a = nodes[i].parent;
+		if (a == TERMINAL) break;
+		if (bottleneck > arcs[a].r_cap) bottleneck = arcs[a].r_cap;
+	}
+	if (bottleneck > - nodes[i].tr_cap) bottleneck = - nodes[i].tr_cap;
+
+
+	/* 2. Augmenting */
+	/* 2a - the source tree */
+	arcs[arcs[middle_arc].sister].r_cap += bottleneck;
+	arcs[middle_arc].r_cap -= bottleneck;
+	for (i=arcs[arcs[middle_arc].sister].head; ; i=arcs[a].head)
+	{
+		a = nodes[i].parent;
+		if (a == TERMINAL) break;
+		arcs[a].r_cap += bottleneck;
+		arcs[arcs[a].sister].r_cap -= bottleneck;
+		if (!arcs[arcs[a].sister].r_cap) set_orphan(i);
+	}
+	nodes[i].tr_cap -= bottleneck;
+	if (!nodes[i].tr_cap) set_orphan(i);
+	/* 2b - the sink tree */
+	for (i=arcs[middle_arc].head; ; i=arcs[a].head)
+	{
+		a = nodes[i].parent;
+		if (a == TERMINAL) break;
+		arcs[arcs[a].sister].r_cap += bottleneck;
+		arcs[a].r_cap -= bottleneck;
+		if (!arcs[a].r_cap) set_orphan(i);
+	}
+	nodes[i].tr_cap += bottleneck;
+	if (!nodes[i].tr_cap) set_orphan(i);
+
+
+	flow += bottleneck;
+}
+
+/***********************************************************************/
+
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::adopt()
+{
+	/* orphans found while processing are appended and handled in turn */
+	for (size_t k=0; k<orphans.size(); k++) process_orphan(orphans[k]);
+	orphans.clear();
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::process_orphan(int i)
+{
+	int t = tree(i), d = distance(i);
+	int a, j;
+
+	/* a new parent one level closer keeps every distance as it is */
+	if (d == 1)
+	{
+		if (has_terminal(i, t)) { nodes[i].parent = TERMINAL; return; }
+	}
+	else
+	{
+		int parent_label = (t == 0) ? d - 1 : 1 - d;
+		for (a=nodes[i].first; a<nodes[i + 1].first; a++)
+		{
+			j = arcs[a].head;
+			if (nodes[j].label == parent_label && to_parent(a, t))
+			{
+				nodes[i].parent = a;
+				return;
+			}
+		}
+	}
+
+	/* otherwise i moves further away and its children lose their parent */
+	for (a=nodes[i].first; a<nodes[i + 1].first; a++)
+	{
+		j = arcs[a].head;
+		if (nodes[j].label != 0 && tree(j) == t && nodes[j].parent == arcs[a].sister) set_orphan(j);
+	}
+
+	nodes[i].label = 0;
+	nodes[i].parent = NONE;
+	if (!attach(i, t, false)) attach(i, 1 - t, true);
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	bool IBFSGraph<captype,tcaptype,flowtype>::attach(int i, int t, bool rescan)
+{
+	int a, j, best_arc = NONE, best_d = INT_MAX;
+
+	if (has_terminal(i, t))
+	{
+		set_label(i, t, 1, TERMINAL);
+		return true;
+	}
+
+	for (a=nodes[i].first; a<nodes[i + 1].first; a++)
+	{
+		j = arcs[a].head;
+		if (nodes[j].label != 0 && tree(j) == t && to_parent(a, t) && distance(j) < best_d)
+		{
+			best_d = distance(j);
+			best_arc = a;
+		}
+	}
+
+	/* a node past the next level would break the level by level growth,
+	   it is left free until the scan of its neighbour reaches it */
+	if (best_arc == NONE || best_d > level[t]) return false;
+
+	/* a relabelled node was scanned closer to the terminal, all its
+	   neighbours are in a tree already */
+	if (!rescan && best_d + 1 < level[t])
+	{
+		nodes[i].label = (t == 0) ? best_d + 1 : - best_d - 1;
+		nodes[i].parent = best_arc;
+		return true;
+	}
+
+	set_label(i, t, best_d + 1, best_arc);
+	return true;
+}
+
+/***********************************************************************/
+
+template <typename captype, typename tcaptype, typename flowtype>
+	void IBFSGraph<captype,tcaptype,flowtype>::compute_segments()
+{
+	int i, a, j;
+	size_t k;
+
+	for (i=0; i<node_num(); i++) nodes[i].segment = 0;
+
+	/* nodes that can still reach the sink */
+	queue.clear();
+	for (i=0; i<node_num(); i++)
+	if (nodes[i].tr_cap < 0)
+	{
+		nodes[i].segment = 2;
+		queue.push_back(i);
+	}
+	for (k=0; k<queue.size(); k++)
+	{
+		i = queue[k];
+		for (a=nodes[i].first; a<nodes[i + 1].first; a++)
+		{
+			j = arcs[a].head;
+			if (!nodes[j].segment && arcs[arcs[a].sister].r_cap > 0)
+			{
+				nodes[j].segment = 2;
+				queue.push_back(j);
+			}
+		}
+	}
+
+	/* nodes the source can still reach */
+	queue.clear();
+	for (i=0; i<node_num(); i++)
+	if (nodes[i].tr_cap > 0 && !nodes[i].segment)
+	{
+		nodes[i].segment = 1;
+		queue.push_back(i);
+	}
+	for (k=0; k<queue.size(); k++)
+	{
+		i = queue[k];
+		for (a=nodes[i].first; a<nodes[i + 1].first; a++)
+		{
+			j = arcs[a].head;
+			if (!nodes[j].segment && arcs[a].r_cap > 0)
+			{
+				nodes[j].segment = 1;
+				queue.push_back(j);
+			}
+		}
+	}
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	flowtype IBFSGraph<captype,tcaptype,flowtype>::maxflow(bool reuse_trees)
+{
+	int i, t;
+
+	/* the flow is always kept, only the trees are built anew */
+	(void)reuse_trees;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	interrupted = false;
+
+	build_arcs();
+	init_trees();
+
+	while ( 1 )
+	{
+		/* nodes that joined a tree below the level it is scanning */
+		while (!pending[0].empty() || !pending[1].empty())
+		{
+			t = pending[0].empty() ? 1 : 0;
+			i = pending[t].back();
+			pending[t].pop_back();
+			/* it may have moved on to a level that is scanned in turn */
+			if (nodes[i].label != 0 && tree(i) == t && distance(i) < level[t]) scan(i, t);
+		}
+
+		for (t=0; t<2; t++)
+		while (active[t].empty() && !next_active[t].empty())
+		{
+			level[t] ++;
+			active[t].swap(next_active[t]);
+		}
+
+		/* a tree that cannot grow any further separates the terminals */
+		if (active[0].empty() || active[1].empty()) break;
+
+		/* checked once per level, a level is a few thousand nodes on an image grid */
+		if ((interrupt_cancel && interrupt_cancel->load(std::memory_order_relaxed)) ||
+			(interrupt_budget > 0 && std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() >= interrupt_budget))
+		{
+			interrupted = true;
+			break;
+		}
+
+		/* grow the tree with the smaller frontier by one level */
+		t = (active[0].size() <= active[1].size()) ? 0 : 1;
+		int label = (t == 0) ? level[t] : -level[t];
+		for (size_t k=0; k<active[t].size(); k++)
+		{
+			i = active[t][k];
+			if (nodes[i].label == label) scan(i, t);
+		}
+
+		active[t].clear();
+		level[t] ++;
+		active[t].swap(next_active[t]);
+	}
+
+	compute_segments();
+	return flow;
+}
+
+/***********************************************************************/
+
+// Same instantiations as graph.cpp, see instances.inc
+template class IBFSGraph<int,int,int>;
+template class IBFSGraph<short,int,int>;
+template class IBFSGraph<float,float,float>;
+template class IBFSGraph<double,double,double>;
@@ -0,0 +1,208 @@
+/* ibfs.h */
+/*
+	Incremental breadth-first search (IBFS) max-flow, after
+
+	"Maximum flows by incremental breadth-first search"
+	Andrew V. Goldberg, Sagi Hed, Haim Kaplan, Robert E. Tarjan and Renato F. Werneck.
+	In ESA 2011.
+
+	Like BK it grows a source and a sink search tree and augments along the
+	paths where they meet, but both trees are kept as breadth-first trees:
+	every node carries its exact distance to its terminal in the residual
+	graph restricted to the tree. Orphans first look for a new parent at
+	the same distance and are otherwise relabelled, which bounds the work
+	per node where BK's trees can degrade.
+
+	The interface is a subset of Graph (graph.h), with the same meaning:
+	add_node(), add_edge(), add_tweights(), maxflow(), what_segment(),
+	mark_node() and reset(). maxflow(true) keeps the flow of the previous
+	call and only rebuilds the trees, so mark_node() is accepted but not
+	needed. After maxflow(), what_segment() returns SINK for nodes that can
+	still reach the sink in the residual graph, SOURCE for nodes the source
+	can still reach, and default_segm otherwise - the same cut BK reports.
+*/
+
+#ifndef __IBFS_H__
+#define __IBFS_H__
+
+#include <assert.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+template <typename captype, typename tcaptype, typename flowtype> class IBFSGraph
+{
+public:
+	typedef enum
+	{
+		SOURCE	= 0,
+		SINK	= 1
+	} termtype; // terminals
+	typedef int node_id;
+
+	// Same meaning as in Graph. Nodes and edges beyond the estimates are
+	// accepted, the arrays just grow.
+	IBFSGraph(int node_num_max, int edge_num_max, void (*err_function)(char *) = NULL);
+
+	~IBFSGraph();
+
+	node_id add_node(int num = 1);
+
+	// Edges may be added after maxflow(), the flow already pushed is kept
+	void add_edge(node_id i, node_id j, captype cap, captype rev_cap);
+
+	void add_tweights(node_id i, tcaptype cap_source, tcaptype cap_sink);
+
+	flowtype maxflow(bool reuse_trees = false);
+
+	termtype what_segment(node_id i, termtype default_segm = SOURCE);
+
+	// Same meaning as in Graph. An interrupted maxflow() still fills the
+	// segments from the residual graph of the flow found so far, and
+	// maxflow(true) carries on from that flow.
+	void set_interrupt(const std::atomic<bool>* cancel, double time_budget = 0) { interrupt_cancel = cancel; interrupt_budget = time_budget; }
+
+	bool is_optimal() { return !interrupted; }
+
+	// The trees are rebuilt by every maxflow() call, nothing to mark
+	void mark_node(node_id i) { assert(i >= 0 && i < node_num()); }
+
+	void reset();
+
+	int get_node_num() { return node_num(); }
+
+	int get_arc_num() { return (int)arcs.size() + 2 * (int)new_edges.size(); }
+
+private:
+
+	// special values of node::parent
+	static const int NONE = -1;
+	static const int TERMINAL = -2;
+	static const int ORPHAN = -3;
+
+	struct node
+	{
+		int			first;		// arcs of the node are arcs[first .. next node's first)
+		int			parent;		// arc to the parent, or one of the values above
+		int			label;		// > 0: distance to the source in the source tree
+								// < 0: minus the distance to the sink in the sink tree
+								// 0: free
+		int			segment;	// set at the end of maxflow(): 1 source, 2 sink, 0 either
+
+		tcaptype	tr_cap;		// if tr_cap > 0 then tr_cap is residual capacity of the arc SOURCE->node
+								// otherwise         -tr_cap is residual capacity of the arc node->SINK
+	};
+
+	struct arc
+	{
+		int			head;		// node the arc points to
+		int			sister;		// reverse arc
+		captype		r_cap;		// residual capacity
+	};
+
+	struct edge
+	{
+		int			i, j;
+		captype		cap, rev_cap;
+	};
+
+	// nodes has one extra entry whose first closes the arcs of the last node
+	std::vector<node>	nodes;
+	std::vector<arc>	arcs;		// grouped by tail, built by build_arcs()
+	std::vector<edge>	new_edges;	// added since the last build_arcs()
+	int					built_node_num;	// node count at the last build_arcs()
+
+	void	(*error_function)(char *);
+
+	flowtype			flow;		// total flow
+
+	// stopping maxflow() early, see set_interrupt()
+	const std::atomic<bool>	*interrupt_cancel;
+	double				interrupt_budget;
+	bool				interrupted;
+
+	// per tree (0 source, 1 sink): level being scanned, nodes at that level,
+	// at the next one, and nodes below it that joined and still need a scan
+	int					level[2];
+	std::vector<int>	active[2], next_active[2], pending[2];
+
+	std::vector<int>	orphans;
+	std::vector<int>	queue;
+
+	int		node_num() { return (int)nodes.size() - 1; }
+
+	void	build_arcs();
+	void	init_trees();
+
+	// distance of i to the terminal of its tree, 0 if free
+	int		distance(int i) { return nodes[i].label > 0 ? nodes[i].label : -nodes[i].label; }
+	int		tree(int i) { return nodes[i].label > 0 ? 0 : 1; }
+
+	// residual capacity of the arc that would attach i to its terminal, or
+	// through arc a (leaving i) to a parent in the given tree
+	bool	has_terminal(int i, int t) { return t == 0 ? nodes[i].tr_cap > 0 : nodes[i].tr_cap < 0; }
+	bool	to_parent(int a, int t) { return t == 0 ? arcs[arcs[a].sister].r_cap > 0 : arcs[a].r_cap > 0; }
+
+	void	set_label(int i, int t, int d, int parent);
+	void	set_orphan(int i);
+
+	void	scan(int i, int t);
+	void	augment(int middle_arc);
+	void	adopt();
+	void	process_orphan(int i);
+
+	// joins i to tree t below its nearest neighbour, returns false if that
+	// is past the next level. Without rescan a node below the level being
+	// scanned is not queued again.
+	bool	attach(int i, int t, bool rescan);
+
+	void	compute_segments();
+};
+
+template <typename captype, typename tcaptype, typename flowtype>
+	inline typename IBFSGraph<captype,tcaptype,flowtype>::node_id IBFSGraph<captype,tcaptype,flowtype>::add_node(int num)
+{
+	assert(num > 0);
+
+	node_id i = node_num();
+	node n = { 0, NONE, 0, 0, 0 };
+	nodes.insert(nodes.end() - 1, num, n);
+	return i;
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	inline void IBFSGraph<captype,tcaptype,flowtype>::add_tweights(node_id i, tcaptype cap_source, tcaptype cap_sink)
+{
+	assert(i >= 0 && i < node_num());
+
+	tcaptype delta = nodes[i].tr_cap;
+	if (delta > 0) cap_source += delta;
+	else           cap_sink   -= delta;
+	flow += (cap_source < cap_sink) ? cap_source : cap_sink;
+	nodes[i].tr_cap = cap_source - cap_sink;
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	inline void IBFSGraph<captype,tcaptype,flowtype>::add_edge(node_id i, node_id j, captype cap, captype rev_cap)
+{
+	assert(i >= 0 && i < node_num());
+	assert(j >= 0 && j < node_num());
+	assert(i != j);
+	assert(cap >= 0);
+	assert(rev_cap >= 0);
+
+	edge e = { i, j, cap, rev_cap };
+	new_edges.push_back(e);
+}
+
+template <typename captype, typename tcaptype, typename flowtype>
+	inline typename IBFSGraph<captype,tcaptype,flowtype>::termtype IBFSGraph<captype,tcaptype,flowtype>::what_segment(node_id i, termtype default_segm)
+{
+	assert(i >= 0 && i < node_num());
+
+	if (nodes[i].segment == 2) return SINK;
+	if (nodes[i].segment == 1) return SOURCE;
+	return default_segm;
+}
+
+#endif
@@ -13,6 +13,8 @@
 
 #define INFINITE_D ((int)(((unsigned)-1)/2))		/* infinite distance to the terminal */
 
+#define INTERRUPT_CHECK_PERIOD 256		/* main loop iterations between two interrupt checks */
+
 /***********************************************************************/
 
 /*
@@ -78,25 +80,39 @@ template <typename captype, typename tcaptype, typename flowtype>
 template <typename captype, typename tcaptype, typename flowtype> 
 	inline void Graph<captype,tcaptype,flowtype>::set_orphan_front(node *i)
 {
-	nodeptr *np;
 	i -> parent = ORPHAN;
-	np = nodeptr_block -> New();
-	np -> ptr = i;
-	np -> next = orphan_first;
-	orphan_first = np;
+	if (i->next_orphan) return; /* already waiting for adoption */
+	i -> next_orphan = (orphan_first) ? orphan_first : i;
+	orphan_first = i;
+	if (!orphan_last) orphan_last = i;
 }
 
 template <typename captype, typename tcaptype, typename flowtype> 
 	inline void Graph<captype,tcaptype,flowtype>::set_orphan_rear(node *i)
 {
-	nodeptr *np;
 	i -> parent = ORPHAN;
-	np = nodeptr_block -> New();
-	np -> ptr = i;
-	if (orphan_last) orphan_last -> next = np;
-	else             orphan_first        = np;
-	orphan_last = np;
-	np -> next = NULL;
+	if (i->next_orphan) return; /* already waiting for adoption */
+	if (orphan_last) orphan_last -> next_orphan = i;
+	else             orphan_first               = i;
+	orphan_last = i;
+	i -> next_orphan = i;
+}
+
+/*
+	Returns the next orphan, or NULL if there are none.
+	The node is linked into the list through next_orphan, so
+	adoption needs no allocation.
+*/
+template <typename captype, typename tcaptype, typename flowtype> 
+	inline typename Graph<captype,tcaptype,flowtype>::node* Graph<captype,tcaptype,flowtype>::next_orphan()
+{
+	node *i = orphan_first;
+
+	if (!i) return NULL;
+	if (i->next_orphan == i) orphan_first = orphan_last = NULL;
+	else                     orphan_first = i -> next_orphan;
+	i -> next_orphan = NULL;
+	return i;
 }
 
 /***********************************************************************/
@@ -121,13 +137,15 @@ template <typename captype, typename tcaptype, typename flowtype>
 
 	queue_first[0] = queue_last[0] = NULL;
 	queue_first[1] = queue_last[1] = NULL;
-	orphan_first = NULL;
+	orphan_first = orphan_last = NULL;
+	resume_first = resume_last = NULL;
 
 	TIME = 0;
 
 	for (i=nodes; i<node_last; i++)
 	{
 		i -> next = NULL;
+		i -> next_orphan = NULL;
 		i -> is_marked = 0;
 		i -> is_in_changed_list = 0;
 		i -> TS = TIME;
@@ -161,7 +179,6 @@ template <typename captype, typename tcaptype, typename flowtype>
 	node* j;
 	node* queue = queue_first[1];
 	arc* a;
-	nodeptr* np;
 
 	queue_first[0] = queue_last[0] = NULL;
 	queue_first[1] = queue_last[1] = NULL;
@@ -169,6 +186,15 @@ template <typename captype, typename tcaptype, typename flowtype>
 
 	TIME ++;
 
+	/* nodes that were active when the last call was interrupted; marked ones are in queue already */
+	while ((i=resume_first))
+	{
+		resume_first = (i->next_orphan == i) ? NULL : i->next_orphan;
+		i->next_orphan = NULL;
+		set_active(i);
+	}
+	resume_last = NULL;
+
 	while ((i=queue))
 	{
 		queue = i->next;
@@ -225,12 +251,8 @@ template <typename captype, typename tcaptype, typename flowtype>
 	//test_consistency();
 
 	/* adoption */
-	while ((np=orphan_first))
+	while ((i=next_orphan()))
 	{
-		orphan_first = np -> next;
-		i = np -> ptr;
-		nodeptr_block -> Delete(np);
-		if (!orphan_first) orphan_last = NULL;
 		if (i->is_sink) process_sink_orphan(i);
 		else            process_source_orphan(i);
 	}
@@ -468,21 +490,77 @@ template <typename captype, typename tcaptype, typename flowtype>
 /***********************************************************************/
 
 template <typename captype, typename tcaptype, typename flowtype> 
-	flowtype Graph<captype,tcaptype,flowtype>::maxflow(bool reuse_trees, Block<node_id>* _changed_list)
+	inline bool Graph<captype,tcaptype,flowtype>::interrupt_requested()
 {
-	node *i, *j, *current_node = NULL;
-	arc *a;
-	nodeptr *np, *np_next;
+	if (!cancel && time_budget <= 0) return false;
+
+	/* reading the clock costs about as much as a few iterations */
+	if (++interrupt_counter < INTERRUPT_CHECK_PERIOD) return false;
+	interrupt_counter = 0;
+
+	if (cancel && cancel->load(std::memory_order_relaxed)) return true;
+	return time_budget > 0 && std::chrono::steady_clock::now() >= deadline;
+}
+
+/*
+	Called when the main loop stops early. queue_first[1] becomes the list
+	of marked nodes until the next call, so the active nodes are moved to
+	the resume list, linked through next_orphan (the orphan list is empty
+	between two iterations). maxflow(true) puts them back with set_active().
+*/
+template <typename captype, typename tcaptype, typename flowtype> 
+	void Graph<captype,tcaptype,flowtype>::save_active_nodes(node* current_node)
+{
+	node *i, *next;
+	int q;
 
-	if (!nodeptr_block)
+	resume_first = resume_last = NULL;
+
+	if ((i=current_node))
+	{
+		/* its active flag is set but it is in neither queue */
+		i -> next = NULL;
+		i -> next_orphan = i;
+		resume_first = resume_last = i;
+	}
+
+	for (q=0; q<2; q++)
 	{
-		nodeptr_block = new DBlock<nodeptr>(NODEPTR_BLOCK_SIZE, error_function);
+		for (i=queue_first[q]; i; i=next)
+		{
+			next = (i->next == i) ? NULL : i->next;
+			i -> next = NULL;
+			if (!i->parent || i->next_orphan) continue;
+
+			if (resume_last) resume_last -> next_orphan = i;
+			else             resume_first               = i;
+			resume_last = i;
+			i -> next_orphan = i;
+		}
+		queue_first[q] = queue_last[q] = NULL;
 	}
 
+	interrupted = true;
+}
+
+/***********************************************************************/
+
+template <typename captype, typename tcaptype, typename flowtype> 
+	flowtype Graph<captype,tcaptype,flowtype>::maxflow(bool reuse_trees, Block<node_id>* _changed_list)
+{
+	node *i, *j, *current_node = NULL;
+	arc *a;
+	node *np, *np_next;
+
 	changed_list = _changed_list;
 	if (maxflow_iteration == 0 && reuse_trees) { if (error_function) (*error_function)("reuse_trees cannot be used in the first call to maxflow()!"); exit(1); }
 	if (changed_list && !reuse_trees) { if (error_function) (*error_function)("changed_list cannot be used without reuse_trees!"); exit(1); }
 
+	interrupted = false;
+	interrupt_counter = 0;
+	if (time_budget > 0)
+		deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(time_budget));
+
 	if (reuse_trees) maxflow_reuse_trees_init();
 	else             maxflow_init();
 
@@ -491,6 +569,12 @@ template <typename captype, typename tcaptype, typename flowtype>
 	{
 		// test_consistency(current_node);
 
+		if (interrupt_requested())
+		{
+			save_active_nodes(current_node);
+			break;
+		}
+
 		if ((i=current_node))
 		{
 			i -> next = NULL; /* remove active flag */
@@ -571,15 +655,13 @@ template <typename captype, typename tcaptype, typename flowtype>
 			/* adoption */
 			while ((np=orphan_first))
 			{
-				np_next = np -> next;
-				np -> next = NULL;
+				/* cut the list after np, orphans created while adopting np go first */
+				np_next = (np->next_orphan == np) ? NULL : np -> next_orphan;
+				np -> next_orphan = np;
+				orphan_last = np;
 
-				while ((np=orphan_first))
+				while ((i=next_orphan()))
 				{
-					orphan_first = np -> next;
-					i = np -> ptr;
-					nodeptr_block -> Delete(np);
-					if (!orphan_first) orphan_last = NULL;
 					if (i->is_sink) process_sink_orphan(i);
 					else            process_source_orphan(i);
 				}
@@ -592,12 +674,6 @@ template <typename captype, typename tcaptype, typename flowtype>
 	}
 	// test_consistency();
 
-	if (!reuse_trees || (maxflow_iteration % 64) == 0)
-	{
-		delete nodeptr_block; 
-		nodeptr_block = NULL; 
-	}
-
 	maxflow_iteration ++;
 	return flow;
 }